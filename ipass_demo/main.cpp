@@ -61,6 +61,8 @@ int main( void ){
 	radio.set_data_rate(rf24_1mbps);
 	radio.set_retransmission(2,15);
 	radio.set_channel(124);
+	// The Arduino transmitter uses RF24_CRC_8
+	radio.set_crc_length(rf24_crc_8);
 	radio.set_transmit_address({0xF1,0xAB,0xAB,0xAB,0xAB});
 	//radio.print_details();
 	// Start listening for incomming messages
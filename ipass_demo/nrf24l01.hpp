@@ -1,3 +1,10 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NRF24L01_HPP
+#define NRF24L01_HPP
 // Commands
 enum commands: uint8_t{
 	R_REGISTER			= 0x00,
@@ -99,4 +106,11 @@ enum data_rate{
 	rf24_1mbps		= 0,
 	rf24_2mbps		= 1,
 	rf24_250kbps	= 2
-};
\ No newline at end of file
+};
+enum crc_length{
+	rf24_crc_disabled	= 0,
+	rf24_crc_8			= 1,
+	rf24_crc_16			= 2
+};
+
+#endif // NRF24L01_HPP
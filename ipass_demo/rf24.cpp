@@ -13,7 +13,8 @@ rf24::rf24(hwlib::spi_bus & bus, hwlib::pin_out & ce, hwlib::pin_out & csn):
 	bus(bus),
 	ce(ce),
 	csn(csn),
-	payload_size(32)
+	payload_size(32),
+	address_width(5)
 {}
 
 /*****************************************************************************************/
@@ -95,6 +96,7 @@ void rf24::print_details(void){
 	print_byte_register("RX_PW_P0-5", RX_PW_P0,5);
 	print_byte_register("EN_AA\t", EN_AA);
 	print_byte_register("EN_RXADDR", EN_RXADDR);
+	print_byte_register("SETUP_AW", SETUP_AW);
 	print_byte_register("SETUP_RETR", SETUP_RETR);
 	print_byte_register("RF_CH\t", RF_CH);
 	print_byte_register("RF_SETUP", RF_SETUP);
@@ -120,7 +122,8 @@ void rf24::write_register_5byte(const uint8_t & reg, const std::array<uint8_t, 5
 	for(uint8_t i = 0; i < 5; i++){
 		input[i+1] = data[i];
 	}
-	bus.write_and_read(csn, input, dummy);
+	// Only clock out the configured address width
+	bus.write_and_read(csn, address_width + 1, input.begin(), dummy.begin());
 }
 
 /*****************************************************************************************/
@@ -308,6 +311,53 @@ void rf24::print_data_rate(void){
 	hwlib::cout << "Data rate: " << rate_str[rate] << '\n';
 }
 
+/*****************************************************************************************/
+void rf24::set_crc_length(uint8_t length){
+	uint8_t config = read_register(NRF_CONFIG) & ~((1<<EN_CRC) | (1<<CRCO));
+	if(length == rf24_crc_disabled){
+		// The chip forces the CRC on when auto acknowledge is enabled
+		if(read_register(EN_AA)){
+			hwlib::cout << "CRC can not be disabled while auto acknowledge is enabled!\n";
+			return;
+		}
+	}else if(length == rf24_crc_8){
+		config |= (1<<EN_CRC);
+	}else if(length == rf24_crc_16){
+		config |= (1<<EN_CRC) | (1<<CRCO);
+	}else{
+		hwlib::cout << "Invalid CRC length, please change parameter!\n";
+		return;
+	}
+	write_register(NRF_CONFIG, config);
+}
+
+/*****************************************************************************************/
+uint8_t rf24::get_crc_length(void){
+	uint8_t config = read_register(NRF_CONFIG);
+	if(!(config & (1<<EN_CRC)) && !read_register(EN_AA)){
+		return rf24_crc_disabled;
+	}
+	if(config & (1<<CRCO)){
+		return rf24_crc_16;
+	}
+	return rf24_crc_8;
+}
+
+/*****************************************************************************************/
+void rf24::set_address_width(const uint8_t & width){
+	if(width < 3 || width > 5){
+		hwlib::cout << "Invalid address width, please change parameter!\n";
+		return;
+	}
+	write_register(SETUP_AW, (width - 2) << AW);
+	address_width = width;
+}
+
+/*****************************************************************************************/
+uint8_t rf24::get_address_width(void){
+	return (read_register(SETUP_AW) & 0x03) + 2;
+}
+
 /*****************************************************************************************/
 void rf24::set_retransmission(const uint8_t & delay, const uint8_t & count){
 	uint8_t setup_retr = ((0xff & delay) << ARD) | ((0xff & count) << ARC);
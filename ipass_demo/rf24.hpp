@@ -22,6 +22,7 @@ private:
 	hwlib::pin_out & ce; // Chip Enable (activates TX or RX mode)
 	hwlib::pin_out & csn; // SPI Chip select
 	uint8_t payload_size;
+	uint8_t address_width;
 	bool dyn_payloads = false;
 	bool payload_no_ack = false;
 
@@ -103,6 +104,28 @@ public:
 	*/
 	void set_data_rate(uint8_t rate);
 	
+	/**
+	* \brief
+	* Set CRC length
+	* \details
+	* This function sets the CRC length that is added to every packet
+	* Input variables are: rf24_crc_disabled, rf24_crc_8, rf24_crc_16\n
+	* These respectively add 0, 1 or 2 bytes to every packet
+	* @note The CRC can not be disabled while auto acknowledge is enabled on any pipe
+	*/
+	void set_crc_length(uint8_t length);
+	
+	/**
+	* \brief
+	* Set address width
+	* \details
+	* This function sets the width of the TX and RX addresses
+	* @param width	The address width in bytes, value between 3-5
+	* @note Only the first width bytes (LSB first) of the addresses given to set_transmit_address()
+	* and set_recieve_address() are used, so set the address width before setting the addresses
+	*/
+	void set_address_width(const uint8_t & width);
+	
 	/**
 	* \brief
 	* Write data to the TX FIFO
@@ -155,7 +178,7 @@ public:
 	* \brief
 	* Set transmission address
 	* \details
-	* This function sets the 5-byte transmission address (LSB first)
+	* This function sets the transmission address (LSB first), by default the address is 5 bytes wide
 	* @code
 	* // Set transmission address to 0xABABABABFF
 	* radio.set_transmit_address({0xFF, 0xAB, 0xAB, 0xAB, 0xAB});
@@ -168,9 +191,9 @@ public:
 	* \brief
 	* Set recieve address
 	* \details
-	* This function sets the 5-byte recieving address on a the given pipe
+	* This function sets the recieving address on a the given pipe
 	* @param pipe		The pipe number. Value between 0-5
-	* @param address	The 5-byte address array (LSB first)
+	* @param address	The address array (LSB first), only the first byte is used for pipes 2-5
 	* \details
 	* Example:
 	* @code
@@ -220,6 +243,22 @@ public:
 	*/
 	void print_data_rate(void);
 	
+	/**
+	* \brief
+	* Get CRC length
+	* @returns rf24_crc_disabled, rf24_crc_8 or rf24_crc_16
+	* @note Reciever and Transmitter must have the same CRC length
+	*/
+	uint8_t get_crc_length(void);
+	
+	/**
+	* \brief
+	* Get address width
+	* @returns The address width in bytes
+	* @note Reciever and Transmitter must have the same address width
+	*/
+	uint8_t get_address_width(void);
+	
 	/**
 	* \brief
 	* Enable dynamic payload size
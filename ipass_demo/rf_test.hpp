@@ -213,6 +213,42 @@ public:
 	}
 	/**
 	* \brief
+	* Test if both radio's use the same link configuration
+	* \details
+	* This function compares the settings that need to be equal on the transmitting and the recieving side,
+	* the test outcome will be printed to the terminal.
+	*/
+	void test_link_configuration(void){
+		hwlib::cout << "\nTesting link configuration of both modules\n";
+		if(module01.get_channel() == module02.get_channel()){
+			hwlib::cout << "[OK]	Channel is equal\n";
+		}else{
+			hwlib::cout << "[FAIL]	Channel differs\n";
+		}
+		if((module01.read_register(R_REGISTER + RF_SETUP) & ((1<<RF_DR_LOW) | (1<<RF_DR_HIGH))) ==
+		   (module02.read_register(R_REGISTER + RF_SETUP) & ((1<<RF_DR_LOW) | (1<<RF_DR_HIGH)))){
+			hwlib::cout << "[OK]	Data rate is equal\n";
+		}else{
+			hwlib::cout << "[FAIL]	Data rate differs\n";
+		}
+		if(module01.get_crc_length() == module02.get_crc_length()){
+			hwlib::cout << "[OK]	CRC length is equal\n";
+		}else{
+			hwlib::cout << "[FAIL]	CRC length differs\n";
+		}
+		if(module01.get_address_width() == module02.get_address_width()){
+			hwlib::cout << "[OK]	Address width is equal\n";
+		}else{
+			hwlib::cout << "[FAIL]	Address width differs\n";
+		}
+		if((module01.read_register(R_REGISTER + FEATURE) & (1<<EN_DPL)) == (module02.read_register(R_REGISTER + FEATURE) & (1<<EN_DPL))){
+			hwlib::cout << "[OK]	Dynamic payload setting is equal\n";
+		}else{
+			hwlib::cout << "[FAIL]	Dynamic payload setting differs\n";
+		}
+	}
+	/**
+	* \brief
 	* Test communication between two radio's
 	* \details
 	* This test writes an constructor with two values from one module to the other.
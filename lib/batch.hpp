@@ -0,0 +1,261 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BATCH_HPP
+#define BATCH_HPP
+#include "rf24.hpp"
+#include "nrf24l01.hpp"
+#include "hwlib.hpp"
+/**
+ * @file batch.hpp
+ */
+
+/// The maximum amount of bytes in a batched record
+const uint8_t batch_record_size = 16;
+/// The maximum record type
+const uint8_t batch_max_type = 15;
+
+/**
+ * \brief
+ * Batching statistics
+ */
+struct batch_statistics{
+	uint32_t records = 0;
+	uint32_t frames = 0;
+	uint32_t failed = 0;
+	uint32_t fill_flushes = 0;
+	uint32_t deadline_flushes = 0;
+	uint32_t priority_flushes = 0;
+};
+
+/**
+ * \brief
+ * Sender which collects records into one frame
+ * \details
+ * A frame starts with the amount of records, every record starts with one byte with the type in the high nibble
+ * and the size minus one in the low nibble, followed by the record itself. The frame is send when the next record
+ * does not fit anymore, when the oldest record has waited max_delay_us, or directly after a priority record.
+ * @code
+ * batch_sender sender(radio, 10000000);
+ * radio.stop_listening();
+ * sender.add(0, data);
+ * sender.add(1, alarm, true);
+ * sender.poll();
+ * @endcode
+ * Records are at most 16 bytes and the type is 0 up to and including 15.
+ */
+class batch_sender
+{
+private:
+	rf24 & radio;
+	uint32_t max_delay_us;
+	std::array<uint8_t, 32> frame = {0};
+	uint8_t length = 1;
+	uint64_t oldest = 0;
+	batch_statistics stats;
+
+	bool send(uint32_t & reason){
+		if(length <= 1){
+			return 1;
+		}
+		radio.write_payload(frame, length);
+		bool result = radio.wait_for_transmission();
+		stats.frames++;
+		reason++;
+		if(!result){
+			stats.failed++;
+		}
+		frame = {0};
+		length = 1;
+		return result;
+	}
+
+public:
+	/**
+	* \brief
+	* The batching sender constructor
+	* @param radio			The radio to send with, must be in TX mode
+	* @param max_delay_us	The maximum time a record waits before the frame is send
+	*/
+	batch_sender(rf24 & radio, const uint32_t & max_delay_us = 1000000):
+		radio(radio),
+		max_delay_us(max_delay_us)
+	{}
+
+	/**
+	* \brief
+	* Add a record to the frame
+	* @param type		The type of the record, 0 up to and including 15
+	* @param record		The record, can be a struct, array etc. of at most 16 bytes
+	* @param priority	Send the frame directly after adding the record
+	* @returns False if the type is invalid or a frame that had to be send failed
+	*/
+	template<typename datatype>
+	bool add(const uint8_t & type, const datatype & record, const bool & priority = false){
+		static_assert(sizeof(record) > 0 && sizeof(record) <= batch_record_size, "Record does not fit in a batch");
+		if(type > batch_max_type){
+			hwlib::cout << "Invalid record type, please change parameter!\n";
+			return 0;
+		}
+		bool result = 1;
+		if(length + 1 + sizeof(record) > 32){
+			result = send(stats.fill_flushes);
+		}
+		if(length == 1){
+			oldest = hwlib::now_us();
+		}
+		frame[length++] = (type << 4) | (sizeof(record) - 1);
+		const uint8_t * data = reinterpret_cast<const uint8_t *>(&record);
+		for(uint8_t i = 0; i < sizeof(record); i++){
+			frame[length++] = data[i];
+		}
+		frame[0]++;
+		stats.records++;
+		if(priority){
+			result = send(stats.priority_flushes) && result;
+		}
+		return result;
+	}
+
+	/**
+	* \brief
+	* Send the frame if the oldest record has waited long enough
+	* \details
+	* Call this function regularly, for example after reading the sensors.
+	* @returns False if the frame has been send and the transmission failed
+	*/
+	bool poll(void){
+		if(length > 1 && hwlib::now_us() - oldest >= max_delay_us){
+			return send(stats.deadline_flushes);
+		}
+		return 1;
+	}
+
+	/**
+	* \brief
+	* Send the frame now
+	* @returns False if the transmission failed
+	*/
+	bool flush(void){
+		uint32_t reason = 0;
+		return send(reason);
+	}
+
+	/**
+	* \brief
+	* Get the amount of records waiting in the frame
+	*/
+	uint8_t pending(void) const {
+		return frame[0];
+	}
+
+	/**
+	* \brief
+	* Get the batching statistics
+	*/
+	const batch_statistics & statistics(void) const {
+		return stats;
+	}
+
+	/**
+	* \brief
+	* Print the batching statistics
+	*/
+	void print_statistics(void) const {
+		hwlib::cout << "Batch records=" << hwlib::dec << stats.records
+					<< " frames=" << stats.frames
+					<< " failed=" << stats.failed
+					<< " fill=" << stats.fill_flushes
+					<< " deadline=" << stats.deadline_flushes
+					<< " priority=" << stats.priority_flushes << '\n';
+	}
+};
+
+/**
+ * \brief
+ * Reader for the records in a recieved batch
+ * @code
+ * std::array<uint8_t, 32> frame;
+ * radio.read(frame);
+ * batch_reader reader(frame);
+ * while(reader.next()){
+ * 	if(reader.type() == 0){
+ * 		reader.get(data);
+ * 	}
+ * }
+ * @endcode
+ */
+class batch_reader
+{
+private:
+	const std::array<uint8_t, 32> & frame;
+	uint8_t remaining;
+	uint8_t position = 1;
+	uint8_t current = 0;
+
+public:
+	/**
+	* \brief
+	* The batch reader constructor
+	* @param frame	The recieved frame, must stay alive while reading
+	*/
+	batch_reader(const std::array<uint8_t, 32> & frame):
+		frame(frame),
+		remaining(frame[0])
+	{}
+
+	/**
+	* \brief
+	* Go to the next record
+	* @returns False if there are no more records or the frame is malformed
+	*/
+	bool next(void){
+		if(current){
+			position += 1 + size();
+			current = 0;
+		}
+		if(remaining == 0 || position >= 32 || position + 1 + (frame[position] & 0x0F) + 1 > 32){
+			return 0;
+		}
+		remaining--;
+		current = 1;
+		return 1;
+	}
+
+	/**
+	* \brief
+	* Get the type of the current record
+	*/
+	uint8_t type(void) const {
+		return frame[position] >> 4;
+	}
+
+	/**
+	* \brief
+	* Get the size of the current record in bytes
+	*/
+	uint8_t size(void) const {
+		return (frame[position] & 0x0F) + 1;
+	}
+
+	/**
+	* \brief
+	* Copy the current record
+	* @returns False if the size of the record does not match the size of d
+	*/
+	template<typename datatype>
+	bool get(datatype & d) const {
+		if(!current || sizeof(d) != size()){
+			return 0;
+		}
+		uint8_t * data = reinterpret_cast<uint8_t *>(&d);
+		for(uint8_t i = 0; i < sizeof(d); i++){
+			data[i] = frame[position + 1 + i];
+		}
+		return 1;
+	}
+};
+
+#endif // BATCH_HPP
@@ -0,0 +1,150 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef CSMA_HPP
+#define CSMA_HPP
+#include "rf24.hpp"
+#include "nrf24l01.hpp"
+#include "hwlib.hpp"
+/**
+ * @file csma.hpp
+ */
+
+/**
+ * \brief
+ * Listen-before-talk statistics
+ */
+struct csma_statistics{
+	uint32_t sent = 0;
+	uint32_t failed = 0;
+	uint32_t channel_busy = 0;
+	uint32_t busy_samples = 0;
+	uint32_t backoffs = 0;
+	uint32_t backoff_time_us = 0;
+	uint32_t retransmissions = 0;
+};
+
+/**
+ * \brief
+ * Listen-before-talk sender
+ * \details
+ * Before every transmission the channel is sampled with the Received Power Detector. When a carrier is detected
+ * the sender waits a random amount of backoff periods, the maximum amount of periods doubles after every busy sample.
+ * This avoids transmitting on top of another transmitter, which would cost retransmissions with the auto retransmit delay.
+ * @code
+ * csma_sender sender(radio);
+ * radio.stop_listening();
+ * if(!sender.write(data)){
+ * 	hwlib::cout << "Data transmission failed!\n";
+ * }
+ * sender.print_statistics();
+ * @endcode
+ */
+class csma_sender
+{
+private:
+	rf24 & radio;
+	uint8_t max_attempts;
+	uint8_t min_exponent;
+	uint8_t max_exponent;
+	uint16_t backoff_period_us;
+	uint32_t random_state;
+	csma_statistics stats;
+
+	uint32_t random(void){
+		// xorshift32
+		random_state ^= random_state << 13;
+		random_state ^= random_state >> 17;
+		random_state ^= random_state << 5;
+		return random_state;
+	}
+
+public:
+	/**
+	* \brief
+	* The listen-before-talk sender constructor
+	* @param radio				The radio to send with, must be in TX mode
+	* @param max_attempts		The amount of times the channel is sampled before giving up
+	* @param min_exponent		The first backoff is between 0 and 2^min_exponent - 1 periods
+	* @param max_exponent		The backoff is at most 2^max_exponent - 1 periods
+	* @param backoff_period_us	The length of a backoff period, about the air time of a short packet
+	*/
+	csma_sender(rf24 & radio, const uint8_t & max_attempts = 5, const uint8_t & min_exponent = 2,
+	            const uint8_t & max_exponent = 5, const uint16_t & backoff_period_us = 250):
+		radio(radio),
+		max_attempts(max_attempts),
+		min_exponent(min_exponent),
+		max_exponent(max_exponent),
+		backoff_period_us(backoff_period_us),
+		random_state(hwlib::now_us() | 1)
+	{}
+
+	/**
+	* \brief
+	* Send data when the channel is free
+	* @param[out] d	The data to be send, can be a struct, string etc.
+	* @returns True if data has been send succesfully, false if the channel stayed busy or the transmission failed
+	*/
+	template<typename datatype>
+	bool write(const datatype & d){
+		uint8_t exponent = min_exponent;
+		for(uint8_t attempt = 0; attempt < max_attempts; attempt++){
+			if(!radio.carrier_detected()){
+				bool result = radio.write(d) && radio.wait_for_transmission();
+				stats.retransmissions += radio.read_register(R_REGISTER + OBSERVE_TX) & 0x0F;
+				if(result){
+					stats.sent++;
+				}else{
+					stats.failed++;
+				}
+				return result;
+			}
+			stats.busy_samples++;
+			uint32_t backoff = (random() % (1 << exponent)) * backoff_period_us;
+			if(backoff){
+				stats.backoffs++;
+				stats.backoff_time_us += backoff;
+				hwlib::wait_us(backoff);
+			}
+			if(exponent < max_exponent){
+				exponent++;
+			}
+		}
+		stats.channel_busy++;
+		return 0;
+	}
+
+	/**
+	* \brief
+	* Get the backoff statistics
+	*/
+	const csma_statistics & statistics(void) const {
+		return stats;
+	}
+
+	/**
+	* \brief
+	* Reset the backoff statistics
+	*/
+	void reset_statistics(void){
+		stats = csma_statistics();
+	}
+
+	/**
+	* \brief
+	* Print the backoff statistics
+	*/
+	void print_statistics(void) const {
+		hwlib::cout << "CSMA sent=" << hwlib::dec << stats.sent
+					<< " failed=" << stats.failed
+					<< " channel_busy=" << stats.channel_busy
+					<< " busy_samples=" << stats.busy_samples
+					<< " backoffs=" << stats.backoffs
+					<< " backoff_time=" << stats.backoff_time_us << "us"
+					<< " retransmissions=" << stats.retransmissions << '\n';
+	}
+};
+
+#endif // CSMA_HPP
@@ -0,0 +1,229 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef LINUX_HAL_HPP
+#define LINUX_HAL_HPP
+#include "hwlib.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
+#include <cstdio>
+#include <cstring>
+/**
+ * @file linux_hal.hpp
+ * \details
+ * rf24 only uses the hwlib interfaces hwlib::spi_bus, hwlib::pin_out and hwlib::pin_in and the microsecond clock
+ * hwlib::now_us(), those form the hardware abstraction. This file has the adapters for Linux userspace,
+ * build with the native hwlib target (Makefile.native) which provides the clock.
+ * @code
+ * spidev_bus spi_bus("/dev/spidev0.0");
+ * sysfs_pin_out CE(25);
+ * unused_pin CSN;
+ * rf24 radio(spi_bus, CE, CSN);
+ * @endcode
+ */
+
+/**
+ * \brief
+ * Pin that does nothing
+ * \details
+ * Use it as CSN with spidev_bus, the kernel drives the chip select of a spidev device.
+ */
+class unused_pin : public hwlib::pin_out
+{
+public:
+	void set(bool, hwlib::buffering = hwlib::buffering::unbuffered) override {}
+};
+
+/**
+ * \brief
+ * SPI bus on a Linux spidev device
+ * \details
+ * Uses SPI mode 0 with 8 bit words, the NRF24L01+ accepts up to 10MHz.
+ * The kernel copies the data out before the transfer and the data in afterwards,
+ * so data_in may be the same buffer as data_out as rf24 requires.
+ */
+class spidev_bus : public hwlib::spi_bus
+{
+private:
+	int fd = -1;
+	uint32_t speed_hz;
+
+public:
+	using hwlib::spi_bus::write_and_read;
+
+	/**
+	* \brief
+	* Open a spidev device
+	* @param device		The device, for example /dev/spidev0.0
+	* @param speed_hz	The SPI clock frequency
+	*/
+	spidev_bus(const char * device, const uint32_t & speed_hz = 8000000):
+		speed_hz(speed_hz)
+	{
+		fd = open(device, O_RDWR);
+		if(fd < 0){
+			hwlib::cout << "Could not open " << device << '\n';
+			return;
+		}
+		uint8_t mode = SPI_MODE_0;
+		uint8_t bits = 8;
+		if(ioctl(fd, SPI_IOC_WR_MODE, &mode) < 0 || ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0 ||
+		   ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &this->speed_hz) < 0){
+			hwlib::cout << "Could not configure " << device << '\n';
+			close(fd);
+			fd = -1;
+		}
+	}
+
+	~spidev_bus(){
+		if(fd >= 0){
+			close(fd);
+		}
+	}
+
+	/**
+	* \brief
+	* Check if the device has been opened and configured
+	*/
+	bool is_open(void) const {
+		return fd >= 0;
+	}
+
+	/**
+	* \brief
+	* Do one transaction
+	* \details
+	* sel is only set for a chip select on a separate GPIO, pass unused_pin otherwise.
+	*/
+	void write_and_read(hwlib::pin_out & sel, const size_t n, const uint8_t data_out[], uint8_t data_in[]) override {
+		spi_ioc_transfer transfer = {};
+		transfer.tx_buf = reinterpret_cast<uintptr_t>(data_out);
+		transfer.rx_buf = reinterpret_cast<uintptr_t>(data_in);
+		transfer.len = n;
+		transfer.speed_hz = speed_hz;
+		transfer.bits_per_word = 8;
+		sel.set(0);
+		if(fd < 0 || ioctl(fd, SPI_IOC_MESSAGE(1), &transfer) < 0){
+			if(data_in != nullptr){
+				for(size_t i = 0; i < n; i++){
+					data_in[i] = 0;
+				}
+			}
+		}
+		sel.set(1);
+	}
+};
+
+/**
+ * \brief
+ * Open the value file of a sysfs GPIO
+ * \details
+ * Exports the GPIO when needed and sets the direction.
+ * @returns The file descriptor, or -1 on failure
+ */
+inline int sysfs_gpio_open(const uint16_t & gpio, const char * direction){
+	char path[64];
+	std::snprintf(path, sizeof(path), "/sys/class/gpio/gpio%u/value", gpio);
+	if(access(path, F_OK) != 0){
+		int export_fd = open("/sys/class/gpio/export", O_WRONLY);
+		if(export_fd >= 0){
+			char number[8];
+			int length = std::snprintf(number, sizeof(number), "%u", gpio);
+			if(write(export_fd, number, length) < 0){
+				hwlib::cout << "Could not export GPIO " << hwlib::dec << gpio << '\n';
+			}
+			close(export_fd);
+		}
+	}
+	char direction_path[64];
+	std::snprintf(direction_path, sizeof(direction_path), "/sys/class/gpio/gpio%u/direction", gpio);
+	int direction_fd = open(direction_path, O_WRONLY);
+	if(direction_fd >= 0){
+		if(write(direction_fd, direction, std::strlen(direction)) < 0){
+			hwlib::cout << "Could not set the direction of GPIO " << hwlib::dec << gpio << '\n';
+		}
+		close(direction_fd);
+	}
+	int fd = open(path, O_RDWR);
+	if(fd < 0){
+		hwlib::cout << "Could not open GPIO " << hwlib::dec << gpio << '\n';
+	}
+	return fd;
+}
+
+/**
+ * \brief
+ * Output pin on a sysfs GPIO
+ */
+class sysfs_pin_out : public hwlib::pin_out
+{
+private:
+	int fd;
+
+public:
+	/**
+	* \brief
+	* Open a GPIO as output
+	* @param gpio	The GPIO number
+	*/
+	sysfs_pin_out(const uint16_t & gpio):
+		fd(sysfs_gpio_open(gpio, "out"))
+	{}
+
+	~sysfs_pin_out(){
+		if(fd >= 0){
+			close(fd);
+		}
+	}
+
+	void set(bool v, hwlib::buffering = hwlib::buffering::unbuffered) override {
+		if(fd >= 0 && write(fd, v ? "1" : "0", 1) < 0){
+			hwlib::cout << "Could not write GPIO\n";
+		}
+	}
+};
+
+/**
+ * \brief
+ * Input pin on a sysfs GPIO
+ * \details
+ * Use it for the IRQ pin, which is active low.
+ */
+class sysfs_pin_in : public hwlib::pin_in
+{
+private:
+	int fd;
+
+public:
+	/**
+	* \brief
+	* Open a GPIO as input
+	* @param gpio	The GPIO number
+	*/
+	sysfs_pin_in(const uint16_t & gpio):
+		fd(sysfs_gpio_open(gpio, "in"))
+	{}
+
+	~sysfs_pin_in(){
+		if(fd >= 0){
+			close(fd);
+		}
+	}
+
+	bool get(hwlib::buffering = hwlib::buffering::unbuffered) override {
+		char value = '1';
+		if(fd >= 0){
+			lseek(fd, 0, SEEK_SET);
+			if(read(fd, &value, 1) < 0){
+				value = '1';
+			}
+		}
+		return value == '1';
+	}
+};
+
+#endif // LINUX_HAL_HPP
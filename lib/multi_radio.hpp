@@ -0,0 +1,244 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef MULTI_RADIO_HPP
+#define MULTI_RADIO_HPP
+#include "rf24.hpp"
+#include "nrf24l01.hpp"
+#include "hwlib.hpp"
+/**
+ * @file multi_radio.hpp
+ */
+
+/**
+ * \brief
+ * Role of a radio in a multi_radio
+ */
+enum radio_role: uint8_t{
+	role_tx		= 0,
+	role_rx		= 1
+};
+
+/**
+ * \brief
+ * Manager for several radios used at the same time
+ * \details
+ * Every radio is either a transmitter or a reciever. Recievers are serviced round-robin by poll(),
+ * when an IRQ pin is attached to a reciever the SPI bus is only used when the IRQ pin is low.
+ * write() hands the data to the next transmitter which is not busy, so transmissions on the transmitters
+ * overlap. Put every transmitter on its own channel to avoid them colliding with each other.
+ * @code
+ * multi_radio<2> radios({&radio, &radio_2});
+ * radios.set_role(1, role_rx);
+ * radios.set_channel(0, 100);
+ * radios.set_channel(1, 110);
+ * radios.begin();
+ * radios.write(data);
+ * size_t index;
+ * if(radios.poll(index)){
+ * 	radios.read(index, data);
+ * }
+ * @endcode
+ */
+template<size_t count>
+class multi_radio
+{
+private:
+	struct radio_statistics{
+		uint32_t sent = 0;
+		uint32_t failed = 0;
+		uint32_t recieved = 0;
+	};
+
+	std::array<rf24 *, count> radios;
+	std::array<hwlib::pin_in *, count> irq = {nullptr};
+	std::array<uint8_t, count> roles;
+	std::array<bool, count> busy = {false};
+	std::array<radio_statistics, count> stats;
+	size_t next_rx = 0;
+	size_t next_tx = 0;
+
+public:
+	/**
+	* \brief
+	* The multi radio constructor
+	* @param radios	Pointers to the radios, all radios are transmitters by default
+	*/
+	multi_radio(const std::array<rf24 *, count> & radios):
+		radios(radios)
+	{
+		roles.fill(role_tx);
+	}
+
+	/**
+	* \brief
+	* Set the role of a radio
+	* @note Call begin() afterwards to apply the role
+	*/
+	void set_role(const size_t & index, const uint8_t & role){
+		if(index < count){
+			roles[index] = role;
+		}
+	}
+
+	/**
+	* \brief
+	* Set the channel of a radio
+	*/
+	void set_channel(const size_t & index, const uint8_t & channel){
+		if(index < count){
+			radios[index]->set_channel(channel);
+		}
+	}
+
+	/**
+	* \brief
+	* Attach the IRQ pin of a reciever
+	* \details
+	* The IRQ pin is active low, poll() then only reads the STATUS of this radio when the pin is low.
+	*/
+	void set_irq(const size_t & index, hwlib::pin_in & pin){
+		if(index < count){
+			irq[index] = &pin;
+		}
+	}
+
+	/**
+	* \brief
+	* Put every radio in the mode of its role
+	*/
+	void begin(void){
+		for(size_t i = 0; i < count; i++){
+			if(roles[i] == role_rx){
+				radios[i]->start_listening();
+			}else{
+				radios[i]->stop_listening();
+			}
+			busy[i] = false;
+		}
+	}
+
+	/**
+	* \brief
+	* Get a radio
+	*/
+	rf24 & operator[](const size_t & index){
+		return *radios[index];
+	}
+
+	/**
+	* \brief
+	* Hand data to the next transmitter which is not busy
+	* \details
+	* A transmitter that does not accept the data, because its TX FIFO is full or it had to flush it,
+	* counts a failed frame and the next transmitter is tried.
+	* @returns False if no transmitter accepted the data
+	*/
+	template<typename datatype>
+	bool write(const datatype & d){
+		service();
+		for(size_t i = 0; i < count; i++){
+			size_t index = (next_tx + i) % count;
+			if(roles[index] != role_tx || busy[index]){
+				continue;
+			}
+			if(!radios[index]->write(d)){
+				// No TX_DS or MAX_RT will follow for this data
+				stats[index].failed++;
+				continue;
+			}
+			busy[index] = true;
+			next_tx = (index + 1) % count;
+			return 1;
+		}
+		return 0;
+	}
+
+	/**
+	* \brief
+	* Check the transmitters for finished transmissions
+	* @returns The amount of transmitters which are still busy
+	*/
+	size_t service(void){
+		size_t pending = 0;
+		for(size_t i = 0; i < count; i++){
+			if(!busy[i]){
+				continue;
+			}
+			uint8_t result = radios[i]->check_transmission();
+			if(result == tx_pending){
+				pending++;
+				continue;
+			}
+			if(result == tx_sent){
+				stats[i].sent++;
+			}else{
+				stats[i].failed++;
+			}
+			busy[i] = false;
+		}
+		return pending;
+	}
+
+	/**
+	* \brief
+	* Wait until all transmitters have finished
+	*/
+	void flush(void){
+		while(service() > 0){}
+	}
+
+	/**
+	* \brief
+	* Find the next reciever with data available
+	* \details
+	* The recievers are checked round-robin starting after the reciever that was returned last time,
+	* so a busy reciever can not starve the others.
+	* @param[in] index	The index of the reciever with data available
+	* @returns True if a reciever has data available
+	*/
+	bool poll(size_t & index){
+		service();
+		for(size_t i = 0; i < count; i++){
+			size_t candidate = (next_rx + i) % count;
+			if(roles[candidate] != role_rx){
+				continue;
+			}
+			if(irq[candidate] != nullptr && irq[candidate]->get()){
+				continue;
+			}
+			if(radios[candidate]->data_available()){
+				index = candidate;
+				next_rx = (candidate + 1) % count;
+				return 1;
+			}
+		}
+		return 0;
+	}
+
+	/**
+	* \brief
+	* Read data from a reciever
+	*/
+	template<typename datatype>
+	void read(const size_t & index, datatype & d){
+		radios[index]->read(d);
+		stats[index].recieved++;
+	}
+
+	/**
+	* \brief
+	* Print the statistics of every radio
+	*/
+	void print_statistics(void) const {
+		for(size_t i = 0; i < count; i++){
+			hwlib::cout << "Radio " << hwlib::dec << i << (roles[i] == role_rx ? " rx" : " tx")
+						<< "\tsent=" << stats[i].sent << " failed=" << stats[i].failed
+						<< " recieved=" << stats[i].recieved << '\n';
+		}
+	}
+};
+
+#endif // MULTI_RADIO_HPP
@@ -1,3 +1,10 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef NRF24L01_HPP
+#define NRF24L01_HPP
 // Commands
 enum commands: uint8_t{
 	R_REGISTER			= 0x00,
@@ -64,6 +71,7 @@ enum bit_mnemonic{
 	ARD				= 4,
 	ARC				= 0,
 	CONT_WAVE		= 7,
+	PLL_LOCK		= 4,
 	RF_DR_LOW		= 5,
 	RF_DR_HIGH		= 3,
 	RF_PWR			= 6,
@@ -99,4 +107,16 @@ enum data_rate{
 	rf24_1mbps		= 0,
 	rf24_2mbps		= 1,
 	rf24_250kbps	= 2
-};
\ No newline at end of file
+};
+enum crc_length{
+	rf24_crc_disabled	= 0,
+	rf24_crc_8			= 1,
+	rf24_crc_16			= 2
+};
+enum transmission_result{
+	tx_pending		= 0,
+	tx_sent			= 1,
+	tx_failed		= 2
+};
+
+#endif // NRF24L01_HPP
@@ -0,0 +1,480 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef OTA_HPP
+#define OTA_HPP
+#include "rf24.hpp"
+#include "nrf24l01.hpp"
+#include "hwlib.hpp"
+/**
+ * @file ota.hpp
+ */
+
+/// The amount of image bytes in one data frame
+const uint8_t ota_chunk_size = 27;
+
+/**
+ * \brief
+ * Frame types of the image transfer
+ */
+enum ota_frame_type: uint8_t{
+	ota_offer			= 0x01,
+	ota_data			= 0x02,
+	ota_status_request	= 0x03,
+	ota_status			= 0x04,
+	ota_finish			= 0x05
+};
+
+/**
+ * \brief
+ * State of an image transfer
+ * \details
+ * The reciever reports idle up to crc error, the sender uses all states.
+ */
+enum ota_state: uint8_t{
+	ota_idle		= 0,
+	ota_receiving	= 1,
+	ota_complete	= 2,
+	ota_crc_error	= 3,
+	ota_sending		= 4,
+	ota_waiting		= 5,
+	ota_failed		= 6
+};
+
+/**
+ * \brief
+ * Update a CRC32 (IEEE 802.3) with data
+ * \details
+ * The CRC is calculated bit by bit, which needs no table in flash or RAM.
+ * Start with crc = 0 and feed the data in any amount of parts.
+ */
+inline uint32_t crc32_update(uint32_t crc, const uint8_t * data, const uint32_t & length){
+	crc = ~crc;
+	for(uint32_t i = 0; i < length; i++){
+		crc ^= data[i];
+		for(uint8_t bit = 0; bit < 8; bit++){
+			crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+		}
+	}
+	return ~crc;
+}
+
+/**
+ * \brief
+ * Image to be send, for example a region of flash
+ */
+class ota_source
+{
+public:
+	/**
+	* \brief
+	* Get the size of the image in bytes
+	*/
+	virtual uint32_t size(void) = 0;
+
+	/**
+	* \brief
+	* Read a part of the image
+	*/
+	virtual void read(const uint32_t & offset, uint8_t * data, const uint8_t & length) = 0;
+};
+
+/**
+ * \brief
+ * Destination of a recieved image, for example a spare region of flash
+ * \details
+ * The image is written in order, one chunk at a time, so the whole image never has to be in RAM.
+ */
+class ota_sink
+{
+public:
+	/**
+	* \brief
+	* Start recieving an image
+	* \details
+	* A sink that kept the part of this image it recieved before, for example before a reset,
+	* can return the size of that part to continue from there. read() is then used to check it.
+	* @returns The offset to continue from
+	*/
+	virtual uint32_t begin(const uint32_t & /*size*/, const uint32_t & /*crc*/){
+		return 0;
+	}
+
+	/**
+	* \brief
+	* Write a part of the image
+	*/
+	virtual void write(const uint32_t & offset, const uint8_t * data, const uint8_t & length) = 0;
+
+	/**
+	* \brief
+	* Read back a part of the image that has been written before
+	*/
+	virtual void read(const uint32_t & /*offset*/, uint8_t * /*data*/, const uint8_t & /*length*/){}
+
+	/**
+	* \brief
+	* Called when the whole image has been recieved
+	* @param valid	True if the CRC of the image is correct
+	*/
+	virtual void finish(const bool & /*valid*/){}
+};
+
+/**
+ * \brief
+ * Image transfer statistics
+ */
+struct ota_statistics{
+	uint32_t chunks = 0;
+	uint32_t repeated_chunks = 0;
+	uint32_t status_requests = 0;
+	uint32_t timeouts = 0;
+	uint64_t duration_us = 0;
+};
+
+/**
+ * \brief
+ * Sender of an image
+ * \details
+ * The image is send in chunks of 27 bytes. After a window of chunks the sender asks the reciever from which offset
+ * it should continue, chunks after a lost chunk are send again. When the transfer stopped, for example because the
+ * reciever was out of range, calling begin() again continues at the offset the reciever reports.
+ * The sender is driven by poll(), so a board can run the reciever at the same time.
+ * Both radios use the same transmit address.
+ * @code
+ * ota_sender sender(radio, source);
+ * radio.stop_listening();
+ * sender.begin();
+ * while(sender.poll()){}
+ * if(sender.get_state() == ota_complete){
+ * 	hwlib::cout << "Image send!\n";
+ * }
+ * @endcode
+ */
+class ota_sender
+{
+private:
+	rf24 & radio;
+	ota_source & source;
+	uint8_t window;
+	uint32_t timeout_us;
+	uint8_t max_retries;
+	uint32_t image_size = 0;
+	uint32_t image_crc = 0;
+	uint32_t offset = 0;
+	uint32_t highest = 0;
+	uint8_t in_window = 0;
+	uint8_t retries = 0;
+	uint8_t state = ota_idle;
+	uint8_t request = ota_offer;
+	uint64_t deadline = 0;
+	uint64_t started = 0;
+	ota_statistics stats;
+
+	static void put32(uint8_t * out, const uint32_t & value){
+		for(uint8_t i = 0; i < 4; i++){
+			out[i] = uint8_t(value >> (8 * i));
+		}
+	}
+
+	static uint32_t get32(const uint8_t * in){
+		return uint32_t(in[0]) | (uint32_t(in[1]) << 8) | (uint32_t(in[2]) << 16) | (uint32_t(in[3]) << 24);
+	}
+
+	void send_request(void){
+		std::array<uint8_t, 32> frame = {0};
+		frame[0] = request;
+		put32(frame.begin() + 1, image_size);
+		put32(frame.begin() + 5, image_crc);
+		stats.status_requests++;
+		radio.write_payload(frame, 9);
+		if(radio.wait_for_transmission()){
+			radio.enter_rx_mode();
+			deadline = hwlib::now_us() + timeout_us;
+			state = ota_waiting;
+		}else{
+			retry();
+		}
+	}
+
+	void send_chunk(void){
+		std::array<uint8_t, 32> frame = {0};
+		uint8_t length = std::min(uint32_t(ota_chunk_size), image_size - offset);
+		frame[0] = ota_data;
+		put32(frame.begin() + 1, offset);
+		source.read(offset, frame.begin() + 5, length);
+		radio.write_payload(frame, 5 + length);
+		stats.chunks++;
+		if(offset < highest){
+			stats.repeated_chunks++;
+		}
+		if(!radio.wait_for_transmission()){
+			// Ask the reciever where to continue
+			in_window = window;
+			return;
+		}
+		offset += length;
+		highest = std::max(highest, offset);
+		in_window++;
+	}
+
+	void retry(void){
+		if(++retries > max_retries){
+			state = ota_failed;
+			stats.duration_us = hwlib::now_us() - started;
+		}
+	}
+
+	void handle_status(const std::array<uint8_t, 32> & frame){
+		in_window = 0;
+		if(frame[1] == ota_complete || frame[1] == ota_crc_error){
+			state = frame[1];
+			stats.duration_us = hwlib::now_us() - started;
+			return;
+		}
+		if(frame[1] == ota_idle){
+			// The reciever has been reset, offer the image again so the sink reports where to continue
+			state = ota_sending;
+			if(request == ota_offer){
+				retry();
+			}
+			request = ota_offer;
+			return;
+		}
+		retries = 0;
+		offset = get32(frame.begin() + 2);
+		state = ota_sending;
+		request = (offset >= image_size) ? ota_finish : ota_status_request;
+	}
+
+public:
+	/**
+	* \brief
+	* The image sender constructor
+	* @param radio			The radio to send with, must be in TX mode
+	* @param source			The image to send
+	* @param window			The amount of chunks after which the progress is checked
+	* @param timeout_us		The time to wait for a status reply
+	* @param max_retries	The amount of times a request is repeated before the transfer fails
+	*/
+	ota_sender(rf24 & radio, ota_source & source, const uint8_t & window = 16,
+	           const uint32_t & timeout_us = 20000, const uint8_t & max_retries = 10):
+		radio(radio),
+		source(source),
+		window(window),
+		timeout_us(timeout_us),
+		max_retries(max_retries)
+	{}
+
+	/**
+	* \brief
+	* Start or continue the transfer
+	* \details
+	* The CRC of the image is calculated first, the image is then offered to the reciever.
+	*/
+	void begin(void){
+		std::array<uint8_t, ota_chunk_size> chunk;
+		image_size = source.size();
+		image_crc = 0;
+		for(uint32_t position = 0; position < image_size; position += ota_chunk_size){
+			uint8_t length = std::min(uint32_t(ota_chunk_size), image_size - position);
+			source.read(position, chunk.begin(), length);
+			image_crc = crc32_update(image_crc, chunk.begin(), length);
+		}
+		stats = ota_statistics();
+		started = hwlib::now_us();
+		offset = 0;
+		highest = 0;
+		retries = 0;
+		request = ota_offer;
+		state = ota_sending;
+	}
+
+	/**
+	* \brief
+	* Take the next step of the transfer
+	* @returns True while the transfer is in progress
+	*/
+	bool poll(void){
+		if(state == ota_sending){
+			if(request == ota_status_request && in_window < window && offset < image_size){
+				send_chunk();
+			}else{
+				send_request();
+			}
+		}else if(state == ota_waiting){
+			if(radio.data_available()){
+				std::array<uint8_t, 32> frame;
+				radio.read(frame);
+				if(frame[0] == ota_status){
+					radio.enter_tx_mode();
+					handle_status(frame);
+				}
+			}else if(hwlib::now_us() > deadline){
+				radio.enter_tx_mode();
+				stats.timeouts++;
+				state = ota_sending;
+				retry();
+			}
+		}
+		return state == ota_sending || state == ota_waiting;
+	}
+
+	/**
+	* \brief
+	* Get the state of the transfer
+	* @returns ota_complete when the reciever has the whole image with a correct CRC
+	*/
+	uint8_t get_state(void) const {
+		return state;
+	}
+
+	/**
+	* \brief
+	* Get the offset the transfer has reached
+	*/
+	uint32_t progress(void) const {
+		return offset;
+	}
+
+	/**
+	* \brief
+	* Get the transfer statistics
+	*/
+	const ota_statistics & statistics(void) const {
+		return stats;
+	}
+
+	/**
+	* \brief
+	* Print the transfer statistics
+	*/
+	void print_statistics(void) const {
+		hwlib::cout << "OTA size=" << hwlib::dec << image_size
+					<< " chunks=" << stats.chunks
+					<< " repeated=" << stats.repeated_chunks
+					<< " requests=" << stats.status_requests
+					<< " timeouts=" << stats.timeouts
+					<< " time=" << (uint32_t)(stats.duration_us / 1000) << "ms\n";
+	}
+};
+
+/**
+ * \brief
+ * Reciever of an image
+ * \details
+ * Chunks are only accepted in order and written to the sink directly, the CRC is updated along the way.
+ * @code
+ * ota_reciever reciever(radio, sink);
+ * radio.start_listening();
+ * while(reciever.poll() != ota_complete){}
+ * @endcode
+ */
+class ota_reciever
+{
+private:
+	rf24 & radio;
+	ota_sink & sink;
+	uint32_t image_size = 0;
+	uint32_t image_crc = 0;
+	uint32_t next = 0;
+	uint32_t crc = 0;
+	uint8_t state = ota_idle;
+
+	void offer(const uint32_t & size, const uint32_t & expected_crc){
+		if(state != ota_idle && state != ota_crc_error && size == image_size && expected_crc == image_crc){
+			// Same image, continue where the transfer stopped
+			return;
+		}
+		image_size = size;
+		image_crc = expected_crc;
+		next = std::min(sink.begin(size, expected_crc), size);
+		crc = 0;
+		std::array<uint8_t, ota_chunk_size> chunk;
+		for(uint32_t position = 0; position < next; position += ota_chunk_size){
+			uint8_t length = std::min(uint32_t(ota_chunk_size), next - position);
+			sink.read(position, chunk.begin(), length);
+			crc = crc32_update(crc, chunk.begin(), length);
+		}
+		state = ota_receiving;
+	}
+
+	void finish(void){
+		if(state == ota_receiving && next >= image_size){
+			state = (crc == image_crc) ? ota_complete : ota_crc_error;
+			sink.finish(state == ota_complete);
+		}
+	}
+
+	void reply(void){
+		std::array<uint8_t, 32> frame = {0};
+		frame[0] = ota_status;
+		frame[1] = state;
+		for(uint8_t i = 0; i < 4; i++){
+			frame[2 + i] = uint8_t(next >> (8 * i));
+		}
+		radio.enter_tx_mode();
+		radio.write_payload(frame, 6);
+		radio.wait_for_transmission();
+		radio.enter_rx_mode();
+	}
+
+	static uint32_t get32(const uint8_t * in){
+		return uint32_t(in[0]) | (uint32_t(in[1]) << 8) | (uint32_t(in[2]) << 16) | (uint32_t(in[3]) << 24);
+	}
+
+public:
+	/**
+	* \brief
+	* The image reciever constructor
+	* @param radio	The radio to recieve with, must be in RX mode
+	* @param sink	The destination of the image
+	*/
+	ota_reciever(rf24 & radio, ota_sink & sink):
+		radio(radio),
+		sink(sink)
+	{}
+
+	/**
+	* \brief
+	* Handle a recieved frame, if any
+	* @returns The state of the image
+	*/
+	uint8_t poll(void){
+		if(!radio.data_available()){
+			return state;
+		}
+		std::array<uint8_t, 32> frame;
+		radio.read(frame);
+		uint32_t value = get32(frame.begin() + 1);
+		if(frame[0] == ota_data){
+			if(state == ota_receiving && value == next && next < image_size){
+				uint8_t length = std::min(uint32_t(ota_chunk_size), image_size - next);
+				sink.write(next, frame.begin() + 5, length);
+				crc = crc32_update(crc, frame.begin() + 5, length);
+				next += length;
+			}
+		}else if(frame[0] == ota_offer){
+			offer(value, get32(frame.begin() + 5));
+			reply();
+		}else if(frame[0] == ota_status_request){
+			reply();
+		}else if(frame[0] == ota_finish){
+			finish();
+			reply();
+		}
+		return state;
+	}
+
+	/**
+	* \brief
+	* Get the amount of bytes recieved in order
+	*/
+	uint32_t recieved(void) const {
+		return next;
+	}
+};
+
+#endif // OTA_HPP
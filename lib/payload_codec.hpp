@@ -0,0 +1,464 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef PAYLOAD_CODEC_HPP
+#define PAYLOAD_CODEC_HPP
+#include "rf24.hpp"
+#include "nrf24l01.hpp"
+#include "hwlib.hpp"
+/**
+ * @file payload_codec.hpp
+ */
+
+/**
+ * \brief
+ * Map a signed value to an unsigned value, small negative values become small unsigned values
+ */
+inline uint32_t zigzag_encode(const int32_t & value){
+	return (uint32_t(value) << 1) ^ uint32_t(value >> 31);
+}
+
+/**
+ * \brief
+ * Undo zigzag_encode()
+ */
+inline int32_t zigzag_decode(const uint32_t & value){
+	return int32_t(value >> 1) ^ -int32_t(value & 1);
+}
+
+/**
+ * \brief
+ * Get the amount of bytes a value takes as varint
+ */
+inline uint8_t varint_size(uint32_t value){
+	uint8_t size = 1;
+	while(value >= 0x80){
+		value >>= 7;
+		size++;
+	}
+	return size;
+}
+
+/**
+ * \brief
+ * Write a value as varint, 7 bits per byte with the highest bit set when another byte follows
+ * @returns The amount of bytes written
+ */
+inline uint8_t write_varint(uint8_t * out, uint32_t value){
+	uint8_t size = 0;
+	while(value >= 0x80){
+		out[size++] = uint8_t(value) | 0x80;
+		value >>= 7;
+	}
+	out[size++] = uint8_t(value);
+	return size;
+}
+
+/**
+ * \brief
+ * Read a varint
+ * @param in		The bytes to read from
+ * @param available	The amount of bytes that can be read
+ * @param[in] value	The decoded value
+ * @returns The amount of bytes read, 0 if the varint is truncated
+ */
+inline uint8_t read_varint(const uint8_t * in, const uint8_t & available, uint32_t & value){
+	value = 0;
+	for(uint8_t i = 0; i < available && i < 5; i++){
+		value |= uint32_t(in[i] & 0x7F) << (7 * i);
+		if(!(in[i] & 0x80)){
+			return i + 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * \brief
+ * Description of a bit-packed field
+ * \details
+ * The field stores values from minimum up to and including minimum + 2^bits - 1,
+ * values outside of this range are clamped.
+ */
+template<uint8_t bits, int32_t minimum = 0>
+struct codec_field{
+	static_assert(bits > 0 && bits <= 32, "A field is 1 up to and including 32 bits wide");
+	static constexpr uint8_t width = bits;
+	static constexpr int32_t offset = minimum;
+};
+
+/**
+ * \brief
+ * Bit-packing codec driven by a compile-time field description
+ * \details
+ * A frame starts with the amount of readings, followed by the readings packed without any padding.
+ * @code
+ * // Temperature -40 up to 87 degrees, humidity 0 up to 127 percent and a 4 bit counter
+ * using dht_packer = bit_packer<codec_field<7, -40>, codec_field<7>, codec_field<4>>;
+ * std::array<uint8_t, 32> frame = {0};
+ * uint8_t readings = 0;
+ * dht_packer::add(frame, readings, {21, 55, 3});
+ * radio.write_payload(frame, dht_packer::frame_size(readings));
+ * @endcode
+ */
+template<typename... fields>
+class bit_packer
+{
+private:
+	static constexpr uint8_t widths[sizeof...(fields)] = {fields::width...};
+	static constexpr int32_t offsets[sizeof...(fields)] = {fields::offset...};
+
+	static void put_bits(uint8_t * out, uint16_t & bit, uint32_t value, const uint8_t & width){
+		for(uint8_t i = 0; i < width; i++){
+			if(value & (uint32_t(1) << i)){
+				out[bit / 8] |= (1 << (bit % 8));
+			}else{
+				out[bit / 8] &= ~(1 << (bit % 8));
+			}
+			bit++;
+		}
+	}
+
+	static uint32_t get_bits(const uint8_t * in, uint16_t & bit, const uint8_t & width){
+		uint32_t value = 0;
+		for(uint8_t i = 0; i < width; i++){
+			if(in[bit / 8] & (1 << (bit % 8))){
+				value |= uint32_t(1) << i;
+			}
+			bit++;
+		}
+		return value;
+	}
+
+public:
+	/// The amount of fields in a reading
+	static constexpr size_t field_count = sizeof...(fields);
+	/// The size of a packed reading in bits
+	static constexpr uint16_t reading_bits = (0 + ... + fields::width);
+	/// The amount of readings that fit in one frame
+	static constexpr uint8_t readings_per_frame = (31 * 8) / reading_bits;
+
+	static_assert(reading_bits <= 31 * 8, "A reading does not fit in a frame");
+
+	/// The values of one reading
+	using reading = std::array<int32_t, field_count>;
+
+	/**
+	* \brief
+	* Get the amount of bytes a frame with a given amount of readings takes
+	*/
+	static constexpr uint8_t frame_size(const uint8_t & readings){
+		return 1 + (readings * reading_bits + 7) / 8;
+	}
+
+	/**
+	* \brief
+	* Add a reading to a frame
+	* @param frame		The frame, cleared by the caller before the first reading
+	* @param readings	The amount of readings in the frame, increased when the reading has been added
+	* @param values		The reading
+	* @returns False if the frame is full
+	*/
+	static bool add(std::array<uint8_t, 32> & frame, uint8_t & readings, const reading & values){
+		if(readings >= readings_per_frame){
+			return 0;
+		}
+		uint16_t bit = 8 + readings * reading_bits;
+		for(size_t i = 0; i < field_count; i++){
+			int64_t maximum = int64_t(offsets[i]) + ((int64_t(1) << widths[i]) - 1);
+			int64_t value = std::max(int64_t(offsets[i]), std::min(int64_t(values[i]), maximum));
+			put_bits(frame.begin(), bit, uint32_t(value - offsets[i]), widths[i]);
+		}
+		readings++;
+		frame[0] = readings;
+		return 1;
+	}
+
+	/**
+	* \brief
+	* Get the amount of readings in a recieved frame
+	*/
+	static uint8_t count(const std::array<uint8_t, 32> & frame){
+		return std::min(frame[0], readings_per_frame);
+	}
+
+	/**
+	* \brief
+	* Get a reading from a recieved frame
+	*/
+	static void get(const std::array<uint8_t, 32> & frame, const uint8_t & index, reading & values){
+		uint16_t bit = 8 + index * reading_bits;
+		for(size_t i = 0; i < field_count; i++){
+			values[i] = int32_t(int64_t(get_bits(frame.begin(), bit, widths[i])) + offsets[i]);
+		}
+	}
+};
+
+/**
+ * \brief
+ * Delta encoder for a stream of readings from one node
+ * \details
+ * Every reading is stored as the difference with the reading before it, as zigzag varints. A slowly changing
+ * sensor value then takes one byte per field. The first reading of a frame is relative to the last reading of
+ * the previous frame, except in a key frame where it is stored as is.
+ * A frame starts with three bytes: the node, a key frame flag with a 7 bit sequence number and the amount of readings.
+ * A key frame is send every key_interval frames and after a failed transmission, so a reciever that missed
+ * a frame is back in sync at the next key frame.
+ * @code
+ * delta_encoder<2> encoder(1);
+ * if(!encoder.add({temperature, humidity})){
+ * 	encoder.write(radio);
+ * 	encoder.add({temperature, humidity});
+ * }
+ * @endcode
+ */
+template<size_t fields>
+class delta_encoder
+{
+public:
+	/// The values of one reading
+	using reading = std::array<int32_t, fields>;
+
+private:
+	uint8_t node;
+	uint8_t key_interval;
+	uint8_t sequence = 0;
+	uint8_t since_key = 0;
+	bool key = true;
+	reading reference = {0};
+	reading last = {0};
+	std::array<uint8_t, 32> buffer = {0};
+	uint8_t length = 3;
+	uint8_t readings = 0;
+
+public:
+	/**
+	* \brief
+	* The delta encoder constructor
+	* @param node			The node the readings are from
+	* @param key_interval	The amount of frames after which a key frame is send
+	*/
+	delta_encoder(const uint8_t & node, const uint8_t & key_interval = 16):
+		node(node),
+		key_interval(key_interval)
+	{}
+
+	/**
+	* \brief
+	* Add a reading to the frame
+	* @returns False if the reading does not fit in the frame anymore
+	*/
+	bool add(const reading & values){
+		const reading & previous = readings ? last : reference;
+		std::array<uint32_t, fields> encoded;
+		uint8_t size = 0;
+		for(size_t i = 0; i < fields; i++){
+			int32_t delta = values[i] - ((readings || !key) ? previous[i] : 0);
+			encoded[i] = zigzag_encode(delta);
+			size += varint_size(encoded[i]);
+		}
+		if(length + size > 32 || readings == 255){
+			return 0;
+		}
+		for(size_t i = 0; i < fields; i++){
+			length += write_varint(buffer.begin() + length, encoded[i]);
+		}
+		last = values;
+		readings++;
+		return 1;
+	}
+
+	/**
+	* \brief
+	* Get the frame
+	* \details
+	* The header is filled in by this function.
+	*/
+	const std::array<uint8_t, 32> & frame(void){
+		buffer[0] = node;
+		buffer[1] = (key ? 0x80 : 0) | (sequence & 0x7F);
+		buffer[2] = readings;
+		return buffer;
+	}
+
+	/**
+	* \brief
+	* Get the amount of bytes in the frame
+	*/
+	uint8_t size(void) const {
+		return length;
+	}
+
+	/**
+	* \brief
+	* Get the amount of readings in the frame
+	*/
+	uint8_t count(void) const {
+		return readings;
+	}
+
+	/**
+	* \brief
+	* Start a new frame after the current frame has been send
+	*/
+	void next(void){
+		if(readings){
+			reference = last;
+		}
+		sequence++;
+		since_key++;
+		key = since_key >= key_interval;
+		if(key){
+			since_key = 0;
+		}
+		length = 3;
+		readings = 0;
+	}
+
+	/**
+	* \brief
+	* Make the next frame a key frame
+	* @note Call this before adding readings to the frame
+	*/
+	void request_key_frame(void){
+		if(!readings){
+			key = true;
+			since_key = 0;
+		}
+	}
+
+	/**
+	* \brief
+	* Send the frame and start a new frame
+	* \details
+	* The radio must be in TX mode. When the transmission fails the next frame is a key frame.
+	* @returns True if the frame has been send succesfully
+	*/
+	bool write(rf24 & radio){
+		if(!readings){
+			return 1;
+		}
+		radio.write_payload(frame(), length);
+		bool result = radio.wait_for_transmission();
+		next();
+		if(!result){
+			request_key_frame();
+		}
+		return result;
+	}
+};
+
+/**
+ * \brief
+ * Decoder for frames of several delta_encoders
+ * \details
+ * The last reading of every node is kept. A frame that does not follow the previous frame of its node is dropped
+ * until the next key frame, the amount of dropped frames is kept in lost().
+ * @code
+ * delta_decoder<2> decoder;
+ * std::array<uint8_t, 32> frame;
+ * std::array<delta_decoder<2>::reading, 16> readings;
+ * uint8_t node;
+ * radio.read(frame);
+ * uint8_t count = decoder.decode(frame, node, readings);
+ * @endcode
+ */
+template<size_t fields, size_t nodes = 8>
+class delta_decoder
+{
+public:
+	/// The values of one reading
+	using reading = std::array<int32_t, fields>;
+
+private:
+	struct node_state{
+		uint8_t node = 0;
+		bool valid = false;
+		uint8_t sequence = 0;
+		reading last = {0};
+	};
+
+	std::array<node_state, nodes> states;
+	uint32_t dropped = 0;
+
+	node_state & find(const uint8_t & node){
+		for(auto & state : states){
+			if(state.valid && state.node == node){
+				return state;
+			}
+		}
+		for(auto & state : states){
+			if(!state.valid){
+				state.node = node;
+				return state;
+			}
+		}
+		node_state & state = states[node % nodes];
+		state.valid = false;
+		state.node = node;
+		return state;
+	}
+
+public:
+	/**
+	* \brief
+	* Decode a recieved frame
+	* @param frame			The recieved frame
+	* @param[in] node		The node the readings are from
+	* @param[in] readings	The decoded readings, readings that do not fit are skipped
+	* @returns The amount of decoded readings, 0 if the frame has been dropped
+	*/
+	template<size_t capacity>
+	uint8_t decode(const std::array<uint8_t, 32> & frame, uint8_t & node, std::array<reading, capacity> & readings){
+		node = frame[0];
+		bool key = frame[1] & 0x80;
+		uint8_t sequence = frame[1] & 0x7F;
+		node_state & state = find(node);
+		if(state.valid && sequence == state.sequence){
+			// Retransmission of a frame of which the acknowledge got lost
+			return 0;
+		}
+		if(!key){
+			if(!state.valid || sequence != ((state.sequence + 1) & 0x7F)){
+				state.valid = false;
+				dropped++;
+				return 0;
+			}
+		}
+		reading value = key ? reading{0} : state.last;
+		uint8_t position = 3;
+		uint8_t count = 0;
+		for(uint8_t i = 0; i < frame[2]; i++){
+			for(size_t f = 0; f < fields; f++){
+				uint32_t encoded;
+				uint8_t size = read_varint(frame.begin() + position, 32 - position, encoded);
+				if(!size){
+					state.valid = false;
+					dropped++;
+					return 0;
+				}
+				position += size;
+				value[f] += zigzag_decode(encoded);
+			}
+			if(count < capacity){
+				readings[count++] = value;
+			}
+		}
+		state.valid = true;
+		state.sequence = sequence;
+		state.last = value;
+		return count;
+	}
+
+	/**
+	* \brief
+	* Get the amount of frames that have been dropped
+	*/
+	uint32_t lost(void) const {
+		return dropped;
+	}
+};
+
+#endif // PAYLOAD_CODEC_HPP
@@ -0,0 +1,171 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef POWER_MONITOR_HPP
+#define POWER_MONITOR_HPP
+#include "hwlib.hpp"
+/**
+ * @file power_monitor.hpp
+ */
+
+/**
+ * \brief
+ * Radio operating states used by the power monitor
+ */
+enum radio_state: uint8_t{
+	state_power_down	= 0,
+	state_startup		= 1,
+	state_standby		= 2,
+	state_tx			= 3,
+	state_rx			= 4
+};
+
+/**
+ * \brief
+ * Energy estimator for the radio
+ * \details
+ * The rf24 class reports every state change to the monitor, the monitor keeps track of the time spent in each state.
+ * The energy is estimated from the typical supply currents in the nRF24L01+ datasheet, these can be changed
+ * to match the power level and data rate in use.
+ * @code
+ * power_monitor monitor;
+ * radio.set_power_monitor(monitor);
+ * radio.write_low_power(data);
+ * monitor.print();
+ * @endcode
+ */
+class power_monitor
+{
+private:
+	std::array<uint64_t, 5> time_us = {0};
+	// Typical currents in uA: power down, start-up, standby-I, TX at 0dBm, RX at 2Mbps
+	std::array<uint32_t, 5> current_ua = {1, 400, 26, 11300, 13500};
+	uint16_t voltage_mv;
+	uint8_t state = state_power_down;
+	uint64_t since;
+	// A state entered with enter_for() changes to next_state at until
+	uint64_t until = 0;
+	uint8_t next_state = state_power_down;
+
+	void update(void){
+		uint64_t now = hwlib::now_us();
+		if(until != 0 && now >= until){
+			time_us[state] += until - since;
+			since = until;
+			state = next_state;
+			until = 0;
+		}
+		time_us[state] += now - since;
+		since = now;
+	}
+public:
+	/**
+	* \brief
+	* The monitor constructor
+	* @param voltage_mv	The supply voltage of the radio in mV
+	*/
+	power_monitor(const uint16_t & voltage_mv = 3300):
+		voltage_mv(voltage_mv),
+		since(hwlib::now_us())
+	{}
+
+	/**
+	* \brief
+	* Register a state change
+	* \details
+	* This function is called by the rf24 class.
+	*/
+	void enter(const uint8_t & new_state){
+		update();
+		state = new_state;
+		until = 0;
+	}
+
+	/**
+	* \brief
+	* Register a state which ends by itself
+	* \details
+	* The radio ends a transmission by itself, after the air time the monitor books the time as after_state.
+	* A state change before that ends the state earlier.
+	* @param new_state		The state entered now
+	* @param duration_us	The time after which the radio leaves the state
+	* @param after_state	The state the radio enters afterwards
+	*/
+	void enter_for(const uint8_t & new_state, const uint32_t & duration_us, const uint8_t & after_state){
+		update();
+		state = new_state;
+		until = since + duration_us;
+		next_state = after_state;
+	}
+
+	/**
+	* \brief
+	* Change the current used for a state
+	* \details
+	* Use this to set the TX current for the power level in use (7.0mA at -18dBm up to 11.3mA at 0dBm)
+	* or the RX current for the data rate in use (12.6mA at 250kbps up to 13.5mA at 2Mbps).
+	*/
+	void set_current(const uint8_t & for_state, const uint32_t & microamps){
+		if(for_state < current_ua.size()){
+			current_ua[for_state] = microamps;
+		}
+	}
+
+	/**
+	* \brief
+	* Get the time spent in a state in microseconds
+	*/
+	uint64_t time_in(const uint8_t & in_state){
+		update();
+		return (in_state < time_us.size()) ? time_us[in_state] : 0;
+	}
+
+	/**
+	* \brief
+	* Get the estimated charge used by the radio in uC
+	*/
+	uint64_t charge_uc(void){
+		update();
+		uint64_t total = 0;
+		for(uint8_t i = 0; i < time_us.size(); i++){
+			total += time_us[i] * current_ua[i];
+		}
+		return total / 1000000;
+	}
+
+	/**
+	* \brief
+	* Get the estimated energy used by the radio in uJ
+	*/
+	uint64_t energy_uj(void){
+		return charge_uc() * voltage_mv / 1000;
+	}
+
+	/**
+	* \brief
+	* Reset all counters
+	*/
+	void reset(void){
+		update();
+		time_us = {0};
+	}
+
+	/**
+	* \brief
+	* Print the time spent in each state and the energy estimate
+	*/
+	void print(void){
+		std::array<hwlib::string<10>, 5> state_str = {"power down", "start-up", "standby", "tx", "rx"};
+		update();
+		hwlib::cout << "Radio energy estimate\n";
+		for(uint8_t i = 0; i < time_us.size(); i++){
+			hwlib::cout << state_str[i] << "\t = " << hwlib::dec << (uint32_t)time_us[i] << "us\n";
+		}
+		hwlib::cout << "charge\t\t = " << (uint32_t)charge_uc() << "uC\n";
+		hwlib::cout << "energy\t\t = " << (uint32_t)energy_uj() << "uJ\n";
+	}
+};
+
+#endif // POWER_MONITOR_HPP
@@ -13,128 +13,220 @@ rf24::rf24(hwlib::spi_bus & bus, hwlib::pin_out & ce, hwlib::pin_out & csn):
 	bus(bus),
 	ce(ce),
 	csn(csn),
-	payload_size(32)
+	payload_size(32),
+	address_width(5)
 {}
 
+/*****************************************************************************************/
+uint8_t rf24::transfer(const uint8_t & length){
+	bus.write_and_read(csn, length, scratch.begin(), scratch.begin());
+	// The chip clocks out STATUS with the command byte of every transaction
+	cached_status = scratch[0];
+	return cached_status;
+}
+
 /*****************************************************************************************/
 uint8_t rf24::read_register(const uint8_t & reg){
-	std::array<uint8_t, 2> input = {reg, 0x00};
-	std::array<uint8_t, 2> output;
-	bus.write_and_read(csn, input, output);
-	return output[1];
+	scratch[0] = reg;
+	scratch[1] = RF24_NOP;
+	transfer(2);
+	return scratch[1];
 }
 
 /*****************************************************************************************/
 std::array<uint8_t, 5> rf24::read_register_5byte(const uint8_t & reg){
-	std::array<uint8_t, 6> input = {0};
-	input[0] = reg;
-	std::array<uint8_t, 6> output;
-	bus.write_and_read(csn, input, output);
-	std::array<uint8_t, 5> return_val = {	output[1],
-											output[2],
-											output[3],
-											output[4],
-											output[5]};
+	scratch[0] = reg;
+	transfer(6);
+	std::array<uint8_t, 5> return_val = {	scratch[1],
+											scratch[2],
+											scratch[3],
+											scratch[4],
+											scratch[5]};
 	return return_val;
 }
 
 /*****************************************************************************************/
 uint8_t rf24::get_status(void){
-	std::array<uint8_t, 1> input = {RF24_NOP};
-	std::array<uint8_t, 1> output;
-	bus.write_and_read(csn, input, output);
-	return output[0];
+	scratch[0] = RF24_NOP;
+	return transfer(1);
 }
 
 /*****************************************************************************************/
-void rf24::print_status(const uint8_t & status){
-	hwlib::cout << "STATUS\t\t =" <<
-	" RX_DR=" << ((status & (1<<RX_DR))?1:0) <<
-	" TX_DS=" << ((status & (1<<TX_DS))?1:0) <<
-	" MAX_RT=" << ((status & (1<<MAX_RT))?1:0) <<
-	" RX_P_NO=" << ((status >> RX_P_NO) & 0x07) <<
-	" TX_FULL=" << ((status & (1<<TX_FULL))?1:0) << '\n';
+rf24_snapshot rf24::snapshot(void){
+	rf24_snapshot result;
+	result.status = get_status();
+	for(uint8_t reg = 0; reg < snapshot_registers; reg++){
+		// 0x18 up to and including 0x1B are reserved
+		result.registers[reg] = (reg > FIFO_STATUS && reg < DYNPD) ? 0 : read_register(R_REGISTER + reg);
+	}
+	std::array<uint8_t, 5> address = read_register_5byte(R_REGISTER + RX_ADDR_P0);
+	std::copy(address.begin(), address.end(), result.rx_addr_p0);
+	address = read_register_5byte(R_REGISTER + RX_ADDR_P1);
+	std::copy(address.begin(), address.end(), result.rx_addr_p1);
+	address = read_register_5byte(R_REGISTER + TX_ADDR);
+	std::copy(address.begin(), address.end(), result.tx_addr);
+	return result;
 }
 
 /*****************************************************************************************/
-void rf24::print_address_register(hwlib::string<32> name, const uint8_t & reg, const uint8_t & qty){
-	std::array<uint8_t, 5> value;
-	hwlib::cout << name << "\t = ";
-	for(uint8_t i = 0; i<qty; i++){
-		value = read_register_5byte(R_REGISTER + (reg + i));
-		hwlib::cout << "0x";
-		for(uint8_t j = 0; j<5; j++){
-			hwlib::cout << hwlib::hex <<value[j];
-		}
-		hwlib::cout << " ";
+void rf24::restore(const rf24_snapshot & saved){
+	ce.set(0);
+	const std::array<uint8_t, 6> config_registers = {NRF_CONFIG, EN_AA, EN_RXADDR, SETUP_AW, SETUP_RETR, RF_SETUP};
+	for(const uint8_t & reg : config_registers){
+		write_register(reg, saved.registers[reg]);
+	}
+	set_channel(saved.registers[RF_CH]);
+	address_width = (saved.registers[SETUP_AW] & 0x03) + 2;
+	std::array<uint8_t, 5> address;
+	std::copy(saved.rx_addr_p0, saved.rx_addr_p0 + 5, address.begin());
+	write_register_5byte(RX_ADDR_P0, address);
+	std::copy(saved.rx_addr_p1, saved.rx_addr_p1 + 5, address.begin());
+	write_register_5byte(RX_ADDR_P1, address);
+	std::copy(saved.tx_addr, saved.tx_addr + 5, address.begin());
+	write_register_5byte(TX_ADDR, address);
+	for(uint8_t reg = RX_ADDR_P2; reg <= RX_ADDR_P5; reg++){
+		write_register(reg, saved.registers[reg]);
+	}
+	for(uint8_t reg = RX_PW_P0; reg <= RX_PW_P5; reg++){
+		write_register(reg, saved.registers[reg]);
+	}
+	write_register(DYNPD, saved.registers[DYNPD]);
+	write_register(FEATURE, saved.registers[FEATURE]);
+	dyn_payloads = saved.registers[FEATURE] & (1<<EN_DPL);
+	payload_no_ack = saved.registers[FEATURE] & (1<<EN_DYN_ACK);
+	write_register(NRF_STATUS, (1<<RX_DR) | (1<<TX_DS) | (1<<MAX_RT));
+	flush_rx();
+	flush_tx();
+	uint8_t config = saved.registers[NRF_CONFIG];
+	if(!(config & (1<<PWR_UP))){
+		set_state(state_power_down);
+	}else if(config & (1<<PRIM_RX)){
+		ce.set(1);
+		set_state(state_rx);
+	}else{
+		set_state(state_standby);
 	}
-	hwlib::cout << '\n';
 }
 
 /*****************************************************************************************/
-void rf24::print_byte_register(hwlib::string<32> name, const uint8_t & reg, const uint8_t & qty){
-	hwlib::cout << name << "\t = ";
-	for(uint8_t i = 0; i<qty; i++){
-		auto value = read_register(R_REGISTER + (reg + i));
-		hwlib::cout << "0x" << hwlib::hex << value << " ";
+rf24_snapshot rf24::start_capture(const uint8_t & channel, const bool & alternate_preamble){
+	rf24_snapshot saved = snapshot();
+	ce.set(0);
+	write_register(EN_AA, 0x00);
+	write_register(EN_RXADDR, (1<<ERX_P0));
+	// An address width of 0 is illegal, the radio then uses a 2 byte address
+	write_register(SETUP_AW, 0x00);
+	address_width = 2;
+	// The address 0x00AA (0x0055) matches the noise before a packet followed by its preamble
+	write_register_5byte(RX_ADDR_P0, {uint8_t(alternate_preamble ? 0x55 : 0xAA), 0x00, 0x00, 0x00, 0x00});
+	write_register(RX_PW_P0, 32);
+	write_register(DYNPD, 0x00);
+	write_register(FEATURE, 0x00);
+	dyn_payloads = false;
+	payload_no_ack = false;
+	set_channel(channel);
+	uint8_t config = saved.registers[NRF_CONFIG];
+	write_register(NRF_CONFIG, ((config | (1<<PWR_UP) | (1<<PRIM_RX)) & ~(1<<EN_CRC)));
+	write_register(NRF_STATUS, (1<<RX_DR) | (1<<TX_DS) | (1<<MAX_RT));
+	flush_rx();
+	if(!(config & (1<<PWR_UP))){
+		standby_at = hwlib::now_us() + startup_delay;
+		wait_for_standby();
 	}
-	hwlib::cout << '\n';
+	ce.set(1);
+	set_state(state_rx);
+	return saved;
 }
 
 /*****************************************************************************************/
-void rf24::print_details(void){
-	
-	hwlib::cout << "NRF24L01+ configuration\n\n";
-	
-	print_status(get_status());
-	
-	print_address_register("RX_ADDR_P0-1", RX_ADDR_P0, 2);
-	print_byte_register("RX_ADDR_P2-5", RX_ADDR_P2, 4);
-	print_address_register("TX_ADDR\t", TX_ADDR);
+rf24_snapshot rf24::start_carrier(const uint8_t & channel, const uint8_t & level){
+	rf24_snapshot saved = snapshot();
+	ce.set(0);
+	uint8_t config = saved.registers[NRF_CONFIG];
+	write_register(NRF_CONFIG, (config | (1<<PWR_UP)) & ~(1<<PRIM_RX));
+	if(!(config & (1<<PWR_UP))){
+		standby_at = hwlib::now_us() + startup_delay;
+		wait_for_standby();
+	}
+	set_power_level(level);
+	write_register(RF_SETUP, read_register(RF_SETUP) | (1<<CONT_WAVE) | (1<<PLL_LOCK));
+	set_channel(channel);
+	// The carrier is transmitted as long as CE is high
+	ce.set(1);
+	set_state(state_tx);
+	return saved;
+}
 
-	print_byte_register("RX_PW_P0-5", RX_PW_P0,5);
-	print_byte_register("EN_AA\t", EN_AA);
-	print_byte_register("EN_RXADDR", EN_RXADDR);
-	print_byte_register("SETUP_RETR", SETUP_RETR);
-	print_byte_register("RF_CH\t", RF_CH);
-	print_byte_register("RF_SETUP", RF_SETUP);
-	print_byte_register("CONFIG\t", NRF_CONFIG);
-	print_byte_register("DYNPD/FEATURE",DYNPD, 2);
-	hwlib::cout << '\n';
+/*****************************************************************************************/
+rf24_snapshot rf24::start_raw_link(const uint8_t & channel, const bool & reciever){
+	rf24_snapshot saved = snapshot();
+	ce.set(0);
+	// CRC can only be disabled when auto acknowledge is disabled
+	write_register(EN_AA, 0x00);
+	write_register(EN_RXADDR, (1<<ERX_P0));
+	write_register(RX_PW_P0, 32);
+	write_register(DYNPD, 0x00);
+	write_register(FEATURE, 0x00);
+	dyn_payloads = false;
+	payload_no_ack = false;
+	set_channel(channel);
+	uint8_t config = saved.registers[NRF_CONFIG];
+	uint8_t link_config = (config | (1<<PWR_UP)) & ~((1<<EN_CRC) | (1<<PRIM_RX));
+	write_register(NRF_CONFIG, reciever ? (link_config | (1<<PRIM_RX)) : link_config);
+	write_register(NRF_STATUS, (1<<RX_DR) | (1<<TX_DS) | (1<<MAX_RT));
+	flush_rx();
+	flush_tx();
+	if(!(config & (1<<PWR_UP))){
+		standby_at = hwlib::now_us() + startup_delay;
+		wait_for_standby();
+	}
+	if(reciever){
+		ce.set(1);
+		set_state(state_rx);
+	}else{
+		set_state(state_standby);
+	}
+	return saved;
+}
+
+/*****************************************************************************************/
+void rf24::print_details(void){
+	// Read all registers first, so the radio is not kept waiting by the slow serial output
+	print_snapshot(hwlib::cout, snapshot());
 }
 
 /*****************************************************************************************/
 void rf24::write_register(const uint8_t & reg, const uint8_t & data){
-	std::array<uint8_t, 2> input;
-	std::array<uint8_t, 2> dummy;
-	input[0] = W_REGISTER + reg;
-	input[1] = data;
-	bus.write_and_read(csn, input, dummy);
+	scratch[0] = W_REGISTER + reg;
+	scratch[1] = data;
+	transfer(2);
+	if(reg == NRF_STATUS){
+		// STATUS was clocked out before the flags were cleared
+		cached_status &= ~data;
+	}
 }
 
 /*****************************************************************************************/
 void rf24::write_register_5byte(const uint8_t & reg, const std::array<uint8_t, 5> & data){
-	std::array<uint8_t, 6> input;
-	std::array<uint8_t, 6> dummy;
-	input[0] = W_REGISTER + reg;
+	scratch[0] = W_REGISTER + reg;
 	for(uint8_t i = 0; i < 5; i++){
-		input[i+1] = data[i];
+		scratch[i+1] = data[i];
 	}
-	bus.write_and_read(csn, input, dummy);
+	// Only clock out the configured address width
+	transfer(address_width + 1);
 }
 
 /*****************************************************************************************/
 void rf24::flush_tx(void){
-	std::array<uint8_t, 1> input = {FLUSH_TX};
-	std::array<uint8_t, 1> dummy;
-	bus.write_and_read(csn, input, dummy);
+	scratch[0] = FLUSH_TX;
+	transfer(1);
 }
 
 /*****************************************************************************************/
 void rf24::flush_rx(void){
-	std::array<uint8_t, 1> input = {FLUSH_RX};
-	std::array<uint8_t, 1> dummy;
-	bus.write_and_read(csn, input, dummy);
+	scratch[0] = FLUSH_RX;
+	transfer(1);
+	cached_status |= (0x07 << RX_P_NO);
 }
 
 /*****************************************************************************************/
@@ -142,15 +234,78 @@ void rf24::power_down(void){
 	ce.set(0);
 	uint8_t config = read_register(NRF_CONFIG);
 	write_register(NRF_CONFIG, config & ~(1<<PWR_UP));
+	set_state(state_power_down);
 }
 
 /*****************************************************************************************/
-void rf24::power_up(void){
+void rf24::start_power_up(void){
 	uint8_t config = read_register(NRF_CONFIG);
 	// Check if the radio is not already powered up, if not power up
 	if(!(config & (1<<PWR_UP))){
 		write_register(NRF_CONFIG, config | (1<<PWR_UP));
+		standby_at = hwlib::now_us() + startup_delay;
+		set_state(state_startup);
+	}
+}
+
+/*****************************************************************************************/
+void rf24::wait_for_standby(void){
+	uint64_t now = hwlib::now_us();
+	if(now < standby_at){
+		hwlib::wait_us(standby_at - now);
 	}
+	standby_at = 0;
+	set_state(state_standby);
+}
+
+/*****************************************************************************************/
+void rf24::power_up(void){
+	start_power_up();
+	wait_for_standby();
+}
+
+/*****************************************************************************************/
+void rf24::set_external_clock(const bool & external_clock){
+	startup_delay = external_clock ? 150 : 1500;
+}
+
+/*****************************************************************************************/
+uint8_t rf24::check_transmission(void){
+	// TX_DS and MAX_RT stay set until they are cleared, so a set flag in the cached STATUS is still valid
+	uint8_t status = cached_status;
+	if(!(status & ((1<<TX_DS) | (1<<MAX_RT)))){
+		status = get_status();
+	}
+	if(!(status & ((1<<TX_DS) | (1<<MAX_RT)))){
+		return tx_pending;
+	}
+	set_state(state_standby);
+	// Reset TX_DS and MAX_RT for the next transmission
+	write_register(NRF_STATUS, (1<<TX_DS) | (1<<MAX_RT));
+	if(status & (1<<MAX_RT)){
+		flush_tx();
+		return tx_failed;
+	}
+	return tx_sent;
+}
+
+/*****************************************************************************************/
+bool rf24::wait_for_transmission(const uint32_t & timeout_us){
+	uint64_t deadline = hwlib::now_us() + timeout_us;
+	uint8_t result = check_transmission();
+	while(result == tx_pending){
+		if(hwlib::now_us() > deadline){
+			set_state(state_standby);
+			return 0;
+		}
+		result = check_transmission();
+	}
+	return result == tx_sent;
+}
+
+/*****************************************************************************************/
+void rf24::set_power_monitor(power_monitor & new_monitor){
+	monitor = &new_monitor;
 }
 
 /*****************************************************************************************/
@@ -204,22 +359,25 @@ void rf24::disable_features(void){
 }
 
 /*****************************************************************************************/
-void rf24::write_payload(const std::array<uint8_t, 32> & data, const uint8_t & length){
-	const uint8_t max_lenght = 32;
-	std::array<uint8_t, 33> input = {0};
-	std::array<uint8_t, 33> dummy;
-	input[0] = W_TX_PAYLOAD;
-	for(uint8_t i = 0; i < std::min(length, max_lenght); i++){
-		input[i+1] = data[i];
-	}
-	/*
-	hwlib::cout << "Writing payload: ";
-	for(uint8_t i = 0; i < 33; i++){
-		hwlib::cout << hwlib::hex << input[i];
-	}
-	hwlib::cout << '\n';
-	 */
-	bus.write_and_read(csn, input, dummy);
+uint8_t rf24::upload_payload(const uint8_t * data, const uint8_t & size, const bool & no_ack){
+	scratch[0] = no_ack ? W_TX_PAYLOAD_NO_ACK : W_TX_PAYLOAD;
+	for(uint8_t i = 0; i < size; i++){
+		scratch[i+1] = data[i];
+	}
+	// With a fixed payload size the payload is padded to 32 bytes
+	uint8_t length = dyn_payloads ? size : 32;
+	for(uint8_t i = size; i < length; i++){
+		scratch[i+1] = 0;
+	}
+	return transfer(length + 1);
+}
+
+/*****************************************************************************************/
+void rf24::pulse_ce(const uint8_t & length){
+	if(monitor != nullptr){
+		// The radio returns to standby by itself once the packet is on air
+		monitor->enter_for(state_tx, air_time_us(length), state_standby);
+	}
 	// Give high pulse to ce for 20ns (minimum specified is 10ns)
 	ce.set(1);
 	hwlib::wait_us(20);
@@ -227,13 +385,37 @@ void rf24::write_payload(const std::array<uint8_t, 32> & data, const uint8_t & l
 }
 
 /*****************************************************************************************/
-void rf24::read_payload(std::array<uint8_t, 32> & buffer){
-	std::array<uint8_t, 33> input = {0};
-	std::array<uint8_t, 33> dummy;
-	input[0] = R_RX_PAYLOAD;
-	bus.write_and_read(csn, input, dummy);
-	for(uint8_t i = 0; i < 32; i++){
-		buffer[i] = dummy[i+1];
+uint16_t rf24::air_time_us(const uint8_t & length){
+	uint8_t setup = read_register(RF_SETUP);
+	// Preamble, address, payload, CRC and the 9 bit packet control field
+	uint16_t bits = 8 * (1 + address_width + (dyn_payloads ? length : 32) + 2) + 9;
+	if(setup & (1<<RF_DR_LOW)){
+		bits *= 4;
+	}else if(setup & (1<<RF_DR_HIGH)){
+		bits /= 2;
+	}
+	// TX settling takes 130us
+	return 130 + bits;
+}
+
+/*****************************************************************************************/
+void rf24::write_payload(const std::array<uint8_t, 32> & data, const uint8_t & length){
+	const uint8_t max_lenght = 32;
+	upload_payload(data.begin(), std::min(length, max_lenght));
+	pulse_ce(std::min(length, max_lenght));
+}
+
+/*****************************************************************************************/
+void rf24::read_payload(uint8_t * data, const uint8_t & length){
+	// Only the requested bytes are clocked out, the chip discards the rest of the payload
+	scratch[0] = R_RX_PAYLOAD;
+	transfer(length + 1);
+	for(uint8_t i = 0; i < length; i++){
+		data[i] = scratch[i+1];
+	}
+	// RX_DR keeps the IRQ pin low until it is cleared, clear it once the RX FIFO is empty
+	if(((get_status() >> RX_P_NO) & 0x07) == 0x07){
+		write_register(NRF_STATUS, (1<<RX_DR));
 	}
 }
 
@@ -308,6 +490,53 @@ void rf24::print_data_rate(void){
 	hwlib::cout << "Data rate: " << rate_str[rate] << '\n';
 }
 
+/*****************************************************************************************/
+void rf24::set_crc_length(uint8_t length){
+	uint8_t config = read_register(NRF_CONFIG) & ~((1<<EN_CRC) | (1<<CRCO));
+	if(length == rf24_crc_disabled){
+		// The chip forces the CRC on when auto acknowledge is enabled
+		if(read_register(EN_AA)){
+			hwlib::cout << "CRC can not be disabled while auto acknowledge is enabled!\n";
+			return;
+		}
+	}else if(length == rf24_crc_8){
+		config |= (1<<EN_CRC);
+	}else if(length == rf24_crc_16){
+		config |= (1<<EN_CRC) | (1<<CRCO);
+	}else{
+		hwlib::cout << "Invalid CRC length, please change parameter!\n";
+		return;
+	}
+	write_register(NRF_CONFIG, config);
+}
+
+/*****************************************************************************************/
+uint8_t rf24::get_crc_length(void){
+	uint8_t config = read_register(NRF_CONFIG);
+	if(!(config & (1<<EN_CRC)) && !read_register(EN_AA)){
+		return rf24_crc_disabled;
+	}
+	if(config & (1<<CRCO)){
+		return rf24_crc_16;
+	}
+	return rf24_crc_8;
+}
+
+/*****************************************************************************************/
+void rf24::set_address_width(const uint8_t & width){
+	if(width < 3 || width > 5){
+		hwlib::cout << "Invalid address width, please change parameter!\n";
+		return;
+	}
+	write_register(SETUP_AW, (width - 2) << AW);
+	address_width = width;
+}
+
+/*****************************************************************************************/
+uint8_t rf24::get_address_width(void){
+	return (read_register(SETUP_AW) & 0x03) + 2;
+}
+
 /*****************************************************************************************/
 void rf24::set_retransmission(const uint8_t & delay, const uint8_t & count){
 	uint8_t setup_retr = ((0xff & delay) << ARD) | ((0xff & count) << ARC);
@@ -324,18 +553,33 @@ void rf24::set_transmit_address(const std::array<uint8_t, 5> & address){
 /*****************************************************************************************/
 void rf24::set_recieve_address(const uint8_t & pipe, const std::array<uint8_t, 5> & address){
 	std::array<uint8_t, 6> pipe_names = {RX_ADDR_P0, RX_ADDR_P1, RX_ADDR_P2, RX_ADDR_P3, RX_ADDR_P4, RX_ADDR_P5};
-	std::array<uint8_t, 6> enable_rx = {ERX_P0, ERX_P1, ERX_P2, ERX_P3, ERX_P4, ERX_P5};
 	if(pipe < 6){
 		if(pipe < 2){
 			write_register_5byte(pipe_names[pipe], address);
 		}else{
 			write_register(pipe_names[pipe], address[0]);
 			// Also enable the corresponding pipe
-			write_register(EN_RXADDR, (1<<enable_rx[pipe]));
+			enable_pipe(pipe);
 		}
 	}
 }
 
+/*****************************************************************************************/
+void rf24::enable_pipe(const uint8_t & pipe){
+	if(pipe < 6){
+		uint8_t en_rxaddr = read_register(EN_RXADDR);
+		write_register(EN_RXADDR, en_rxaddr | (1<<pipe));
+	}
+}
+
+/*****************************************************************************************/
+void rf24::disable_pipe(const uint8_t & pipe){
+	if(pipe < 6){
+		uint8_t en_rxaddr = read_register(EN_RXADDR);
+		write_register(EN_RXADDR, en_rxaddr & ~(1<<pipe));
+	}
+}
+
 /*****************************************************************************************/
 void rf24::start_listening(void){
 	ce.set(0);
@@ -346,12 +590,14 @@ void rf24::start_listening(void){
 	uint8_t status = (1<<RX_DR) | (1<<TX_DS) | (1<<MAX_RT);
 	write_register(NRF_STATUS, status);
 	ce.set(1);
+	set_state(state_rx);
 	flush_rx();
 }
 
 /*****************************************************************************************/
 void rf24::stop_listening(void){
 	ce.set(0);
+	set_state(state_standby);
 	hwlib::wait_ms(200);
 	uint8_t config = read_register(NRF_CONFIG);
 	write_register(NRF_CONFIG, config & ~(1<<PRIM_RX));
@@ -363,14 +609,90 @@ void rf24::stop_listening(void){
 	power_up();
 }
 
+/*****************************************************************************************/
+void rf24::enter_rx_mode(void){
+	ce.set(0);
+	uint8_t config = read_register(NRF_CONFIG);
+	write_register(NRF_CONFIG, config | (1<<PWR_UP) | (1<<PRIM_RX));
+	if(!(config & (1<<PWR_UP))){
+		standby_at = hwlib::now_us() + startup_delay;
+		wait_for_standby();
+	}
+	ce.set(1);
+	// RX settling time
+	hwlib::wait_us(130);
+	set_state(state_rx);
+}
+
+/*****************************************************************************************/
+void rf24::enter_tx_mode(void){
+	ce.set(0);
+	uint8_t config = read_register(NRF_CONFIG);
+	write_register(NRF_CONFIG, (config | (1<<PWR_UP)) & ~(1<<PRIM_RX));
+	if(!(config & (1<<PWR_UP))){
+		standby_at = hwlib::now_us() + startup_delay;
+	}
+	wait_for_standby();
+}
+
+/*****************************************************************************************/
+void rf24::retune(const uint8_t & channel, const bool & keep_fifos){
+	uint8_t config = read_register(NRF_CONFIG);
+	bool listening = (config & (1<<PRIM_RX)) && (config & (1<<PWR_UP));
+	ce.set(0);
+	set_channel(channel);
+	if(!keep_fifos){
+		if(listening){
+			flush_rx();
+		}else{
+			flush_tx();
+		}
+	}
+	if(listening){
+		ce.set(1);
+		// PLL settling time
+		hwlib::wait_us(130);
+	}
+}
+
+/*****************************************************************************************/
+bool rf24::carrier_detected(void){
+	ce.set(0);
+	uint8_t config = read_register(NRF_CONFIG);
+	write_register(NRF_CONFIG, config | (1<<PRIM_RX));
+	ce.set(1);
+	// RX settling time plus the time the RPD needs to sample the channel
+	hwlib::wait_us(170);
+	bool carrier = read_register(RPD) & 0x01;
+	ce.set(0);
+	write_register(NRF_CONFIG, config);
+	if(config & (1<<PRIM_RX)){
+		ce.set(1);
+	}
+	return carrier;
+}
+
 /*****************************************************************************************/
 bool rf24::data_available(void){
-	uint8_t status = read_register(FIFO_STATUS);
-	// Check if RX_EMPTY bit has been set, if not data is available
-	if(!(status & (1<<RX_EMPTY) )){
-		return 1;
+	// A pipe number in the cached STATUS stays valid until the payload is read or flushed,
+	// otherwise a single byte NOP gets the current STATUS
+	if(((cached_status >> RX_P_NO) & 0x07) > 5){
+		get_status();
+	}
+	return ((cached_status >> RX_P_NO) & 0x07) <= 5;
+}
+
+/*****************************************************************************************/
+uint8_t rf24::read_frame(std::array<uint8_t, 32> & data, uint8_t & pipe){
+	if(!data_available()){
+		return 0;
 	}
-	return 0;
+	pipe = (cached_status >> RX_P_NO) & 0x07;
+	uint8_t length = dyn_payloads ? get_payload_size() : read_register(RX_PW_P0 + pipe);
+	const uint8_t max_length = 32;
+	length = std::min(length, max_length);
+	read_payload(data.begin(), length);
+	return length;
 }
 
 /*****************************************************************************************/
@@ -6,6 +6,8 @@
 #ifndef RF24_HPP
 #define RF24_HPP
 #include "hwlib.hpp"
+#include "power_monitor.hpp"
+#include "rf24_snapshot.hpp"
 /**
  * @file rf24.hpp
  */
@@ -22,8 +24,16 @@ private:
 	hwlib::pin_out & ce; // Chip Enable (activates TX or RX mode)
 	hwlib::pin_out & csn; // SPI Chip select
 	uint8_t payload_size;
+	uint8_t address_width;
 	bool dyn_payloads = false;
 	bool payload_no_ack = false;
+	uint16_t startup_delay = 1500;
+	uint64_t standby_at = 0;
+	power_monitor * monitor = nullptr;
+	// Buffer of every SPI transaction, the command and data are overwritten by the response
+	std::array<uint8_t, 33> scratch;
+	// STATUS as clocked out at the start of the last SPI transaction
+	uint8_t cached_status = 0x0E;
 
 public:
 
@@ -36,7 +46,9 @@ public:
 	* \brief
 	* The library constructor
 	* \details
-	* Call this function to initialize the module
+	* Call this function to initialize the module.
+	* Every transaction uses one buffer in the object for the data out and in, the bus must read each byte
+	* before the response overwrites it, as the hwlib bit banged bus does.
 	* @param bus	The SPI-bus where the module is connected to
 	* @param ce		The Chip Enable pin
 	* @param csn	The Chip Select pin
@@ -77,6 +89,45 @@ public:
 	*/
 	void stop_listening(void);
 	
+	/**
+	* \brief
+	* Switch to RX mode without flushing the FIFOs
+	* \details
+	* Unlike start_listening() this function only changes the mode, the status flags and FIFOs are kept.
+	* The function returns after the 130us RX settling time.
+	*/
+	void enter_rx_mode(void);
+	
+	/**
+	* \brief
+	* Switch to TX mode without flushing the FIFOs
+	* \details
+	* Unlike stop_listening() this function does not wait and keeps the status flags and FIFOs.
+	*/
+	void enter_tx_mode(void);
+	
+	/**
+	* \brief
+	* Change the channel while listening or transmitting
+	* \details
+	* CE is dropped, the channel is written and the radio is put back in the mode it was in.
+	* In RX mode the function returns after the 130us PLL settling time, in TX mode the settling time
+	* is part of the next transmission. This replaces stop_listening(), set_channel() and start_listening().
+	* @param channel	The new channel, 0 up to and including 125
+	* @param keep_fifos	Keep the data in the FIFOs, otherwise the FIFO of the current mode is flushed
+	*/
+	void retune(const uint8_t & channel, const bool & keep_fifos = true);
+	
+	/**
+	* \brief
+	* Check for a carrier on the current channel
+	* \details
+	* Enters RX mode for the 170us the chip needs to sample the Received Power Detector (RPD),
+	* then returns to the previous mode. The FIFOs are kept.
+	* @returns True if a signal stronger than -64dBm is present on the channel
+	*/
+	bool carrier_detected(void);
+	
 	/**
 	* \brief
 	* Check if there is data available to be read
@@ -84,6 +135,18 @@ public:
 	*/
 	bool data_available(void);
 	
+	/**
+	* \brief
+	* Read the next frame with its length and pipe
+	* \details
+	* The pipe comes from the STATUS byte, the length from the payload width with dynamic payloads
+	* or from the RX_PW register of the pipe otherwise.
+	* @param[in] data	The frame where the payload is stored into
+	* @param[in] pipe	The pipe the frame has been recieved on
+	* @returns The length of the frame, 0 if the RX FIFO is empty
+	*/
+	uint8_t read_frame(std::array<uint8_t, 32> & data, uint8_t & pipe);
+	
 	/**
 	* \brief
 	* Set power level
@@ -103,37 +166,83 @@ public:
 	*/
 	void set_data_rate(uint8_t rate);
 	
+	/**
+	* \brief
+	* Set CRC length
+	* \details
+	* This function sets the CRC length that is added to every packet
+	* Input variables are: rf24_crc_disabled, rf24_crc_8, rf24_crc_16\n
+	* These respectively add 0, 1 or 2 bytes to every packet
+	* @note The CRC can not be disabled while auto acknowledge is enabled on any pipe
+	*/
+	void set_crc_length(uint8_t length);
+	
+	/**
+	* \brief
+	* Set address width
+	* \details
+	* This function sets the width of the TX and RX addresses
+	* @param width	The address width in bytes, value between 3-5
+	* @note Only the first width bytes (LSB first) of the addresses given to set_transmit_address()
+	* and set_recieve_address() are used, so set the address width before setting the addresses
+	*/
+	void set_address_width(const uint8_t & width);
+	
 	/**
 	* \brief
 	* Write data to the TX FIFO
 	* \details
 	* Make sure to call set_transmis_address() first to set the address to transmit to.
 	* @param[out] d	The data to be send, can be a struct, string etc.
-	* @returns True if data has been send succesfully
+	* @returns False if the previous transmission hit the maximum amount of retransmissions or the TX FIFO was full
 	* @note Data is send with a variable payload size by default, the maximum size is 32 bytes,
 	* any more bytes will be ignored. To disable variable payload length call disable_dyn_payload()
 	* data will then be send with a fixed 32 byte payload size.
 	*/
 	template<typename datatype>
 	bool write(const datatype & d){
-		if(dyn_payloads){
-			write_payload( *(std::array<uint8_t, sizeof(d)> *) & d, sizeof(d));
-		}else{
-			// This typecast is written by https://github.com/wovo/
-			write( *(std::array<uint8_t, sizeof(d)> *) & d, sizeof(d) );
-		}
-		uint8_t status = read_register(0x07);
-		if((status & (1<<4))){
+		// The STATUS clocked out during the upload tells if the previous transmission failed
+		uint8_t status = upload_payload(d);
+		pulse_ce(std::min(sizeof(d), size_t(32)));
+		if((status & (1<<MAX_RT))){
 			// Flush tx fifo since data transmission has failed and return 0
 			flush_tx();
 			// But reset MAX_RT first for the next round
-			status = (1<<4);
-			write_register(0x07, status);
+			write_register(NRF_STATUS, (1<<MAX_RT));
 			return 0;
 		}
-		return 1;
+		// A full TX FIFO ignores the payload
+		return !(status & (1<<TX_FULL));
 	}
 	
+	/**
+	* \brief
+	* Write data to the TX FIFO without requesting an acknowledge
+	* \details
+	* Use this function for broadcasts to multiple recievers, the recievers will not send an acknowledge
+	* and the data will not be retransmitted.
+	* @param[out] d	The data to be send, can be a struct, string etc.
+	*/
+	template<typename datatype>
+	void write_no_ack(const datatype & d){
+		if(!payload_no_ack){
+			enable_dyn_ack();
+		}
+		upload_payload(d, true);
+		pulse_ce(std::min(sizeof(d), size_t(32)));
+	}
+	
+	/**
+	* \brief
+	* Write the first bytes of a frame to the TX FIFO
+	* \details
+	* With variable payload length only the given amount of bytes is send, which is shorter on air than
+	* sending the whole frame. Use wait_for_transmission() or check_transmission() for the result.
+	* @param data	The frame to be send
+	* @param length	The amount of bytes to send, at most 32
+	*/
+	void write_payload(const std::array<uint8_t, 32> & data, const uint8_t & length);
+	
 	/**
 	* \brief
 	* Read available data from RX FIFO
@@ -143,7 +252,8 @@ public:
 	* @note
 	* Data that has been recieved always has an 32 byte size, make sure the supplied variables
 	* size is big enough for the data or some of it might get lost.\n
-	* Make sure the supplied data type is the same as the one being used with the write() function. 
+	* Make sure the supplied data type is the same as the one being used with the write() function.\n
+	* RX_DR is cleared once the RX FIFO is empty, so the IRQ pin goes high again after the last payload has been read.
 	*/
 	template<typename datatype>
 	void read(datatype & d){
@@ -155,7 +265,7 @@ public:
 	* \brief
 	* Set transmission address
 	* \details
-	* This function sets the 5-byte transmission address (LSB first)
+	* This function sets the transmission address (LSB first), by default the address is 5 bytes wide
 	* @code
 	* // Set transmission address to 0xABABABABFF
 	* radio.set_transmit_address({0xFF, 0xAB, 0xAB, 0xAB, 0xAB});
@@ -168,9 +278,9 @@ public:
 	* \brief
 	* Set recieve address
 	* \details
-	* This function sets the 5-byte recieving address on a the given pipe
+	* This function sets the recieving address on a the given pipe
 	* @param pipe		The pipe number. Value between 0-5
-	* @param address	The 5-byte address array (LSB first)
+	* @param address	The address array (LSB first), only the first byte is used for pipes 2-5
 	* \details
 	* Example:
 	* @code
@@ -181,14 +291,170 @@ public:
 	*/
 	void set_recieve_address(const uint8_t & pipe, const std::array<uint8_t, 5> & address);
 	
+	/**
+	* \brief
+	* Enable a recieve pipe
+	* @param pipe	The pipe number. Value between 0-5
+	*/
+	void enable_pipe(const uint8_t & pipe);
+	
+	/**
+	* \brief
+	* Disable a recieve pipe
+	* @param pipe	The pipe number. Value between 0-5
+	* @note Pipe 0 is used to recieve the auto acknowledge, enable it again before transmitting
+	*/
+	void disable_pipe(const uint8_t & pipe);
+	
 	// --- End Primary functions ---
 	///@}
+	/** @name Power functions
+	*  These functions are for battery powered nodes that keep the radio powered down between transmissions.
+	*/
+	///@{
+	
+	/**
+	* \brief
+	* Power down the radio
+	* \details
+	* In power down mode the radio uses about 900nA, the register values are kept
+	*/
+	void power_down(void);
+	
+	/**
+	* \brief
+	* Power up the radio
+	* \details
+	* If the radio was powered down, this function waits until the crystal oscillator has started (Tpd2stby)
+	*/
+	void power_up(void);
+	
+	/**
+	* \brief
+	* Set the start-up time of the oscillator
+	* \details
+	* The start-up time from power down to standby is 1.5ms with the crystal on the module.
+	* When the module is driven by an external clock this is only 150us.
+	* @param external_clock True if the module is driven by an external clock
+	*/
+	void set_external_clock(const bool & external_clock);
+	
+	/**
+	* \brief
+	* Transmit data from power down and power down again
+	* \details
+	* The payload is uploaded while the oscillator starts up, the radio is powered down
+	* as soon as the transmission has been acknowledged or has failed.
+	* @param[out] d	The data to be send, can be a struct, string etc.
+	* @returns True if data has been send succesfully
+	* @note Call stop_listening() once before using this function
+	*/
+	template<typename datatype>
+	bool write_low_power(const datatype & d){
+		start_power_up();
+		upload_payload(d);
+		wait_for_standby();
+		pulse_ce(std::min(sizeof(d), size_t(32)));
+		bool result = wait_for_transmission();
+		power_down();
+		return result;
+	}
+	
+	/**
+	* \brief
+	* Wait until the current transmission has finished
+	* \details
+	* Polls the STATUS register until TX_DS or MAX_RT has been set, both flags are cleared afterwards.
+	* @param timeout_us	Maximum time to wait in microseconds
+	* @returns True if the transmission has been acknowledged, false if it failed or timed out
+	*/
+	bool wait_for_transmission(const uint32_t & timeout_us = 100000);
+	
+	/**
+	* \brief
+	* Check if the current transmission has finished without waiting
+	* \details
+	* Reads the STATUS register once, when TX_DS or MAX_RT has been set both flags are cleared.
+	* On MAX_RT the TX FIFO is flushed.
+	* @returns tx_pending, tx_sent or tx_failed
+	*/
+	uint8_t check_transmission(void);
+	
+	/**
+	* \brief
+	* Attach a power monitor
+	* \details
+	* The power monitor keeps track of the time spent in each state and estimates the used energy.
+	* A transmission is booked as TX for the air time of one attempt, calculated from the payload length and
+	* data rate, and as standby afterwards. Every transmission then costs one extra register read.
+	*/
+	void set_power_monitor(power_monitor & new_monitor);
+	
+	// End Power functions
+	///@}
 	/** @name Advanced functions
 	*  These are for advanced operations of the chip and are not particular necessary for normal operations.
 	* A lot of these functions are also for debugging purposes
 	*/
 	///@{
 	
+	/**
+	* \brief
+	* Read all registers
+	* \details
+	* The registers are read in one go without printing in between, use the formatters in rf24_snapshot.hpp
+	* to print the snapshot later, or send it as is to the host.
+	*/
+	rf24_snapshot snapshot(void);
+	
+	/**
+	* \brief
+	* Write the configuration of a snapshot back to the radio
+	* \details
+	* The FIFOs are flushed, the radio is put back in RX mode, standby or power down as in the snapshot.
+	*/
+	void restore(const rf24_snapshot & saved);
+	
+	/**
+	* \brief
+	* Start capturing all packets on a channel
+	* \details
+	* The radio listens with a 2 byte address that matches the start of any packet, with CRC and auto acknowledge
+	* disabled and a fixed 32 byte payload. Every recieved payload then holds the raw bits of a packet from its
+	* address on: address, packet control field, payload and CRC. Use rf24_capture to collect the packets and
+	* restore() with the returned snapshot to stop capturing.
+	* @param channel			The channel to capture on, the data rate must already be set
+	* @param alternate_preamble	Match packets whose address starts with a 0 bit instead of a 1 bit
+	* @returns A snapshot of the configuration before capturing
+	*/
+	rf24_snapshot start_capture(const uint8_t & channel, const bool & alternate_preamble = false);
+	
+	/**
+	* \brief
+	* Start transmitting a constant carrier
+	* \details
+	* The radio transmits an unmodulated carrier with the PLL locked to the channel, for measuring output power
+	* and frequency with a spectrum analyzer. restore() with the returned snapshot stops the carrier.
+	* @param channel	The channel of the carrier
+	* @param level		The PA level, pwr_min up to and including pwr_max
+	* @returns A snapshot of the configuration before the carrier was started
+	*/
+	rf24_snapshot start_carrier(const uint8_t & channel, const uint8_t & level);
+	
+	/**
+	* \brief
+	* Start a raw link for bit error measurement
+	* \details
+	* Auto acknowledge and CRC are disabled and only pipe 0 is used with a fixed 32 byte payload, so corrupted
+	* packets are recieved instead of dropped. Both radios need the same transmit address and data rate.
+	* The transmitter sends with write_payload() and wait_for_transmission(), restore() with the returned
+	* snapshot ends the link.
+	* @param channel	The channel of the link
+	* @param reciever	Start listening, otherwise the radio waits in standby to transmit
+	* @returns A snapshot of the configuration before the link was started
+	*/
+	rf24_snapshot start_raw_link(const uint8_t & channel, const bool & reciever);
+	
 	/**
 	* \brief
 	* Print radio configuration
@@ -220,6 +486,22 @@ public:
 	*/
 	void print_data_rate(void);
 	
+	/**
+	* \brief
+	* Get CRC length
+	* @returns rf24_crc_disabled, rf24_crc_8 or rf24_crc_16
+	* @note Reciever and Transmitter must have the same CRC length
+	*/
+	uint8_t get_crc_length(void);
+	
+	/**
+	* \brief
+	* Get address width
+	* @returns The address width in bytes
+	* @note Reciever and Transmitter must have the same address width
+	*/
+	uint8_t get_address_width(void);
+	
 	/**
 	* \brief
 	* Enable dynamic payload size
@@ -294,10 +576,7 @@ public:
 private:
 	
 	uint8_t get_status(void);
-	void print_status(const uint8_t & status);
-	
-	void print_address_register(hwlib::string<32> name, const uint8_t & reg, const uint8_t & length = 1);
-	void print_byte_register(hwlib::string<32> name, const uint8_t & reg, const uint8_t & length = 1);
+	uint8_t transfer(const uint8_t & length);
 	
 	void write_register(const uint8_t & reg, const uint8_t & data);
 	void write_register_5byte(const uint8_t & reg, const std::array<uint8_t, 5> & data);
@@ -305,60 +584,41 @@ private:
 	void flush_tx(void);
 	void flush_rx(void);
 	
-	void power_down(void);
-	void power_up(void);
+	void start_power_up(void);
+	void wait_for_standby(void);
+	void set_state(const uint8_t & state){
+		if(monitor != nullptr){
+			monitor->enter(state);
+		}
+	}
+	void pulse_ce(const uint8_t & length);
+	uint16_t air_time_us(const uint8_t & length);
 	
 	void enable_dyn_ack(void);
 	void disable_dyn_ack(void);
 	
-	void write_payload(const std::array<uint8_t, 32> & data, const uint8_t & length);
+	uint8_t upload_payload(const uint8_t * data, const uint8_t & size, const bool & no_ack = false);
 	
-	template<size_t size>
-	void write_payload(const std::array<uint8_t, size> & data, const uint8_t & length){
-		std::array<uint8_t, size +1> input = {0};
-		std::array<uint8_t, size +1> dummy;
-		input[0] = 0xA0;
-		for(uint8_t i = 0; i < length; i++){
-			input[i+1] = data[i];
-		}
-		/*
-		hwlib::cout << "Writing payload: ";
-		for(uint8_t i = 0; i < length; i++){
-			hwlib::cout << hwlib::hex << input[i];
-		}
-		hwlib::cout << '\n';
-		*/
-		bus.write_and_read(csn, input, dummy);
-		// Give high pulse to ce for 20ns (minimum specified is 10ns)
-		ce.set(1);
-		hwlib::wait_us(20);
-		ce.set(0);
+	template<typename datatype>
+	uint8_t upload_payload(const datatype & d, const bool & no_ack = false){
+		return upload_payload(reinterpret_cast<const uint8_t *>(&d), std::min(sizeof(d), size_t(32)), no_ack);
 	}
 	
-	void read_payload(std::array<uint8_t, 32> & buffer);
+	void read_payload(uint8_t * data, const uint8_t & length);
 	
-	template<size_t size>
-	void write(const std::array<uint8_t, size> & data, const uint8_t length){
-		uint8_t max_length = 32;
-		std::array<uint8_t, 32> input = {0};
-		for(uint8_t i = 0; i < std::min(length, max_length); i++){
-			input[i] = data[i];
-		}
-		write_payload(input, 32);
-	}
 	template<size_t size>
 	void read(std::array<uint8_t, size> & data, uint8_t length){
 		if(dyn_payloads){
 			length = get_payload_size();
 			//hwlib::cout << "Recieved payload length: " << hwlib::dec << length << '\n';
 		}
-		std::array<uint8_t, 32> buffer;
-		uint8_t max_length = 32;
-		read_payload(buffer);
-		for(uint8_t i = 0; i < std::min(length, max_length); i++){
-				data[i] = buffer[i];
-		}
+		const uint8_t max_length = std::min(size, size_t(32));
+		read_payload(data.begin(), std::min(length, max_length));
 	}
 };
 
+/// The RAM budget of one rf24 instance in bytes
+const size_t rf24_ram_budget = 96;
+static_assert(sizeof(rf24) <= rf24_ram_budget, "rf24 instance exceeds its RAM budget");
+
 #endif // RF24_HPP
@@ -0,0 +1,302 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef RF24_ASYNC_HPP
+#define RF24_ASYNC_HPP
+#include "rf24.hpp"
+#include "nrf24l01.hpp"
+#include "hwlib.hpp"
+/**
+ * @file rf24_async.hpp
+ */
+
+/**
+ * \brief
+ * State of an asynchronous operation
+ */
+enum async_state: uint8_t{
+	async_idle		= 0,
+	async_busy		= 1,
+	async_done		= 2,
+	async_failed	= 3
+};
+
+/**
+ * \brief
+ * Handle of an asynchronous radio operation
+ * \details
+ * The handle is owned by the caller and is completed by rf24_async::poll(),
+ * it must stay alive until the operation is done.
+ */
+class async_operation
+{
+private:
+	friend class rf24_async;
+	uint8_t state = async_idle;
+	uint64_t deadline = 0;
+
+public:
+	/**
+	* \brief
+	* Check if the operation is still in progress
+	*/
+	bool busy(void) const {
+		return state == async_busy;
+	}
+
+	/**
+	* \brief
+	* Check if the operation has completed, succesfully or not
+	*/
+	bool done(void) const {
+		return state == async_done || state == async_failed;
+	}
+
+	/**
+	* \brief
+	* Check if the operation has completed succesfully
+	*/
+	bool succeeded(void) const {
+		return state == async_done;
+	}
+
+	/**
+	* \brief
+	* Get the async_state of the operation
+	*/
+	uint8_t get_state(void) const {
+		return state;
+	}
+};
+
+/**
+ * \brief
+ * Non-blocking interface for the radio
+ * \details
+ * send(), receive() and set_channel() start an operation and return immediately, poll() advances the operations
+ * and completes their handles. The application can do other work, like sampling a sensor, in between calls to poll().
+ * When the IRQ pin of the radio is attached, poll() only uses the SPI bus when the IRQ pin is low.
+ * @code
+ * rf24_async async_radio(radio);
+ * async_operation sent;
+ * async_radio.send(sent, data);
+ * while(!sent.done()){
+ * 	// Read a sensor
+ * 	async_radio.poll();
+ * }
+ * @endcode
+ * One send, one receive and one channel switch can be in progress at the same time. A pending receive
+ * is suspended while sending and the radio returns to RX mode afterwards.
+ * A channel switch waits until a pending send has completed.
+ * @note Starting an operation costs a few SPI transactions plus the 130us RX settling time when the radio
+ * has to enter RX mode, keep the radio powered up to avoid the power up delay.
+ */
+class rf24_async
+{
+private:
+	rf24 & radio;
+	hwlib::pin_in * irq = nullptr;
+	async_operation * send_op = nullptr;
+	async_operation * receive_op = nullptr;
+	async_operation * channel_op = nullptr;
+	uint8_t * receive_data = nullptr;
+	uint8_t receive_size = 0;
+	uint8_t channel = 0;
+	std::array<uint8_t, 32> frame;
+
+	static void complete(async_operation * & op, const uint8_t & state){
+		op->state = state;
+		op = nullptr;
+	}
+
+	static bool expired(const async_operation * op, const uint64_t & now){
+		return op->deadline != 0 && now > op->deadline;
+	}
+
+	static uint64_t deadline(const uint32_t & timeout_us){
+		return timeout_us ? hwlib::now_us() + timeout_us : 0;
+	}
+
+	void poll_send(const uint64_t & now){
+		uint8_t result = radio.check_transmission();
+		if(result == tx_pending){
+			if(!expired(send_op, now)){
+				return;
+			}
+			result = tx_failed;
+		}
+		complete(send_op, result == tx_sent ? async_done : async_failed);
+		if(receive_op != nullptr){
+			radio.enter_rx_mode();
+		}
+	}
+
+	void poll_receive(const uint64_t & now){
+		if(radio.data_available()){
+			radio.read(frame);
+			for(uint8_t i = 0; i < receive_size; i++){
+				receive_data[i] = frame[i];
+			}
+			complete(receive_op, async_done);
+		}else if(expired(receive_op, now)){
+			complete(receive_op, async_failed);
+			radio.enter_tx_mode();
+		}
+	}
+
+	void poll_channel(void){
+		radio.retune(channel);
+		complete(channel_op, async_done);
+	}
+
+public:
+	/**
+	* \brief
+	* The asynchronous radio constructor
+	* @param radio	The radio, call begin() and set the addresses first
+	*/
+	rf24_async(rf24 & radio):
+		radio(radio)
+	{}
+
+	/**
+	* \brief
+	* Attach the IRQ pin of the radio
+	* \details
+	* The IRQ pin is active low, poll() then skips the STATUS reads while the pin is high.
+	*/
+	void set_irq(hwlib::pin_in & pin){
+		irq = &pin;
+	}
+
+	/**
+	* \brief
+	* Start sending data
+	* @param op			The handle which is completed when the data has been acknowledged or the transmission failed
+	* @param d			The data to be send, can be a struct, string etc.
+	* @param timeout_us	The time after which the operation fails, 0 waits for the auto retransmit to finish
+	* @returns False if a send is already in progress
+	* @note When the radio does not accept the data, because the TX FIFO is full or the previous transmission failed,
+	* the operation fails immediately.
+	*/
+	template<typename datatype>
+	bool send(async_operation & op, const datatype & d, const uint32_t & timeout_us = 0){
+		static_assert(sizeof(d) <= 32, "Data does not fit in a frame");
+		if(send_op != nullptr){
+			return 0;
+		}
+		radio.enter_tx_mode();
+		// Clear the result of a transmission that timed out earlier
+		radio.check_transmission();
+		op.state = async_busy;
+		op.deadline = deadline(timeout_us);
+		send_op = &op;
+		if(!radio.write(d)){
+			// No TX_DS or MAX_RT will follow for this data
+			complete(send_op, async_failed);
+			if(receive_op != nullptr){
+				radio.enter_rx_mode();
+			}
+		}
+		return 1;
+	}
+
+	/**
+	* \brief
+	* Start recieving data
+	* \details
+	* The radio enters RX mode and stays there until data has been recieved or the timeout expires.
+	* @param op			The handle which is completed when data has been recieved
+	* @param d			The variable where the data is to be stored into, it must stay alive until the operation is done
+	* @param timeout_us	The time after which the operation fails, 0 waits forever
+	* @returns False if a receive is already in progress
+	*/
+	template<typename datatype>
+	bool receive(async_operation & op, datatype & d, const uint32_t & timeout_us = 0){
+		static_assert(sizeof(d) <= 32, "Data does not fit in a frame");
+		if(receive_op != nullptr){
+			return 0;
+		}
+		op.state = async_busy;
+		op.deadline = deadline(timeout_us);
+		receive_op = &op;
+		receive_data = reinterpret_cast<uint8_t *>(&d);
+		receive_size = sizeof(d);
+		if(send_op == nullptr){
+			radio.enter_rx_mode();
+		}
+		return 1;
+	}
+
+	/**
+	* \brief
+	* Start switching to another channel
+	* @param op			The handle which is completed when the radio is on the new channel
+	* @param channel	The new channel, 0 up to and including 125
+	* @returns False if a channel switch is already in progress
+	*/
+	bool set_channel(async_operation & op, const uint8_t & channel){
+		if(channel_op != nullptr){
+			return 0;
+		}
+		op.state = async_busy;
+		op.deadline = 0;
+		channel_op = &op;
+		this->channel = channel;
+		if(send_op == nullptr){
+			poll_channel();
+		}
+		return 1;
+	}
+
+	/**
+	* \brief
+	* Cancel a pending receive
+	*/
+	void cancel_receive(void){
+		if(receive_op != nullptr){
+			complete(receive_op, async_failed);
+			if(send_op == nullptr){
+				radio.enter_tx_mode();
+			}
+		}
+	}
+
+	/**
+	* \brief
+	* Advance the pending operations
+	* \details
+	* Call this function often, a send is completed within one call after the radio has finished.
+	* @returns True if an operation is still in progress
+	*/
+	bool poll(void){
+		uint64_t now = hwlib::now_us();
+		bool interrupt = irq == nullptr || !irq->get();
+		if(send_op != nullptr && (interrupt || expired(send_op, now))){
+			poll_send(now);
+		}
+		if(channel_op != nullptr && send_op == nullptr){
+			poll_channel();
+		}
+		if(receive_op != nullptr && send_op == nullptr && (interrupt || expired(receive_op, now))){
+			poll_receive(now);
+		}
+		return send_op != nullptr || receive_op != nullptr || channel_op != nullptr;
+	}
+
+	/**
+	* \brief
+	* Poll until an operation is done
+	* @returns True if the operation has completed succesfully
+	*/
+	bool wait(const async_operation & op){
+		while(op.busy()){
+			poll();
+		}
+		return op.succeeded();
+	}
+};
+
+#endif // RF24_ASYNC_HPP
@@ -0,0 +1,153 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef RF24_CAPTURE_HPP
+#define RF24_CAPTURE_HPP
+#include "rf24.hpp"
+#include "nrf24l01.hpp"
+#include "rf24_log.hpp"
+#include "hwlib.hpp"
+/**
+ * @file rf24_capture.hpp
+ */
+
+/**
+ * \brief
+ * A captured frame
+ */
+struct captured_frame{
+	uint32_t timestamp_us;
+	std::array<uint8_t, 32> data;
+};
+
+/**
+ * \brief
+ * Packet sniffer
+ * \details
+ * Puts the radio in capture mode (see rf24::start_capture()) and collects the raw frames with a timestamp
+ * in a ring buffer. poll() only uses the SPI bus, so it keeps up with a packet every ~200us at 2Mbps.
+ * The serial console is much slower than the air: write() streams the buffered frames as log records
+ * when there is time, for example between bursts, or capture() fills the buffer first and sends it afterwards.
+ * Convert the log to pcap with tools/rf24_pcap.
+ * @code
+ * rf24_capture<128> sniffer(radio);
+ * radio.set_data_rate(rf24_2mbps);
+ * sniffer.begin(76);
+ * sniffer.capture(1000000);
+ * sniffer.end();
+ * sniffer.print_statistics();
+ * @endcode
+ */
+template<size_t capacity = 64>
+class rf24_capture
+{
+private:
+	rf24 & radio;
+	rf24_log_writer log;
+	rf24_snapshot saved;
+	std::array<captured_frame, capacity> frames;
+	size_t head = 0;
+	size_t size = 0;
+	uint8_t channel = 0;
+	uint32_t captured = 0;
+	uint32_t dropped = 0;
+	uint32_t fifo_full = 0;
+
+public:
+	/**
+	* \brief
+	* The capture constructor
+	* @param radio	The radio to capture with
+	* @param out	The stream the log records are written to
+	*/
+	rf24_capture(rf24 & radio, hwlib::ostream & out = hwlib::cout):
+		radio(radio),
+		log(out)
+	{}
+
+	/**
+	* \brief
+	* Start capturing on a channel
+	*/
+	void begin(const uint8_t & new_channel, const bool & alternate_preamble = false){
+		channel = new_channel;
+		saved = radio.start_capture(channel, alternate_preamble);
+	}
+
+	/**
+	* \brief
+	* Stop capturing and restore the configuration of the radio
+	*/
+	void end(void){
+		radio.restore(saved);
+	}
+
+	/**
+	* \brief
+	* Move the frames in the RX FIFO to the buffer
+	* \details
+	* When the RX FIFO was full a frame may have been lost, this is counted in the statistics.
+	* @returns The amount of frames in the buffer
+	*/
+	size_t poll(void){
+		uint8_t fifo = radio.read_register(FIFO_STATUS);
+		if(fifo & (1<<RX_FULL)){
+			fifo_full++;
+		}
+		while(!(fifo & (1<<RX_EMPTY))){
+			uint32_t timestamp = hwlib::now_us();
+			if(size < capacity){
+				captured_frame & frame = frames[(head + size) % capacity];
+				frame.timestamp_us = timestamp;
+				radio.read(frame.data);
+				size++;
+				captured++;
+			}else{
+				std::array<uint8_t, 32> discard;
+				radio.read(discard);
+				dropped++;
+			}
+			fifo = radio.read_register(FIFO_STATUS);
+		}
+		return size;
+	}
+
+	/**
+	* \brief
+	* Write buffered frames as log records
+	* @param max_frames	The maximum amount of frames to write
+	*/
+	void write(const size_t & max_frames = capacity){
+		for(size_t i = 0; i < max_frames && size > 0; i++){
+			log.write_capture(frames[head].timestamp_us, channel, frames[head].data);
+			head = (head + 1) % capacity;
+			size--;
+		}
+	}
+
+	/**
+	* \brief
+	* Capture until the buffer is full or the time is up, then write the buffer
+	*/
+	void capture(const uint32_t & duration_us){
+		uint64_t deadline = hwlib::now_us() + duration_us;
+		while(hwlib::now_us() < deadline && poll() < capacity){}
+		write();
+	}
+
+	/**
+	* \brief
+	* Print the capture statistics
+	* \details
+	* Frames can be dropped because the buffer was full (dropped) or because the RX FIFO overflowed (fifo_full).
+	*/
+	void print_statistics(void) const {
+		hwlib::cout << "Capture captured=" << hwlib::dec << captured
+					<< " dropped=" << dropped
+					<< " fifo_full=" << fifo_full << '\n';
+	}
+};
+
+#endif // RF24_CAPTURE_HPP
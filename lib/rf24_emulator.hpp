@@ -0,0 +1,411 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef RF24_EMULATOR_HPP
+#define RF24_EMULATOR_HPP
+#include "hwlib.hpp"
+#include "nrf24l01.hpp"
+/**
+ * @file rf24_emulator.hpp
+ */
+
+/**
+ * \brief
+ * SPI bus which returns the bytes it is given
+ * \details
+ * Stands in for a real bus with MOSI wired to MISO, use it to check code that drives an spi_bus
+ * without hardware.
+ */
+class spi_loopback : public hwlib::spi_bus
+{
+private:
+	uint32_t transactions = 0;
+	uint32_t bytes = 0;
+
+public:
+	using hwlib::spi_bus::write_and_read;
+
+	/**
+	* \brief
+	* Copy the data out to the data in
+	*/
+	void write_and_read(hwlib::pin_out & sel, const size_t n, const uint8_t data_out[], uint8_t data_in[]) override {
+		sel.set(0);
+		for(size_t i = 0; i < n; i++){
+			uint8_t byte = (data_out == nullptr) ? 0 : data_out[i];
+			if(data_in != nullptr){
+				data_in[i] = byte;
+			}
+		}
+		sel.set(1);
+		transactions++;
+		bytes += n;
+	}
+
+	/**
+	* \brief
+	* Get the amount of transactions
+	*/
+	uint32_t get_transactions(void) const {
+		return transactions;
+	}
+
+	/**
+	* \brief
+	* Get the amount of transferred bytes
+	*/
+	uint32_t get_bytes(void) const {
+		return bytes;
+	}
+};
+
+/**
+ * \brief
+ * SPI bus which behaves like a NRF24L01+
+ * \details
+ * Emulates the registers, the addresses and the TX and RX FIFOs, so rf24 can run on a PC without a radio.
+ * Two emulators connected with connect() form a link: a payload uploaded in TX mode is delivered to the peer
+ * when it listens on the same channel and data rate and one of its enabled pipes has the TX address.
+ * With auto acknowledge the transmission fails with MAX_RT when the peer did not take the payload.
+ * Payloads can also be put in the RX FIFO directly with inject().
+ *
+ * CE is not emulated: a payload is sent as soon as it is uploaded and the radio listens whenever PRIM_RX
+ * and PWR_UP are set. The retransmission timing and the ack payloads are not emulated.
+ * @code
+ * rf24_emulator air_1, air_2;
+ * air_1.connect(air_2);
+ * rf24 radio_1(air_1, ce_1, csn_1);
+ * rf24 radio_2(air_2, ce_2, csn_2);
+ * @endcode
+ */
+class rf24_emulator : public hwlib::spi_bus
+{
+private:
+	struct fifo{
+		std::array<std::array<uint8_t, 32>, 3> payloads;
+		std::array<uint8_t, 3> lengths;
+		std::array<uint8_t, 3> pipes;
+		std::array<bool, 3> no_ack;
+		uint8_t count = 0;
+
+		bool push(const uint8_t * data, const uint8_t & length, const uint8_t & pipe, const bool & without_ack){
+			if(count == 3){
+				return 0;
+			}
+			for(uint8_t i = 0; i < 32; i++){
+				payloads[count][i] = (i < length) ? data[i] : 0;
+			}
+			lengths[count] = length;
+			pipes[count] = pipe;
+			no_ack[count] = without_ack;
+			count++;
+			return 1;
+		}
+
+		void pop(void){
+			for(uint8_t i = 1; i < count; i++){
+				payloads[i-1] = payloads[i];
+				lengths[i-1] = lengths[i];
+				pipes[i-1] = pipes[i];
+				no_ack[i-1] = no_ack[i];
+			}
+			if(count){
+				count--;
+			}
+		}
+	};
+
+	std::array<uint8_t, 32> registers;
+	std::array<std::array<uint8_t, 5>, 3> addresses;
+	fifo rx;
+	fifo tx;
+	rf24_emulator * peer = nullptr;
+	uint32_t transactions = 0;
+	uint32_t sent = 0;
+	uint32_t recieved = 0;
+	uint32_t overflows = 0;
+
+	uint8_t address_width(void) const {
+		// An address width of 0 is illegal, the chip then uses 2 bytes
+		return (registers[SETUP_AW] & 0x03) + 2;
+	}
+
+	uint8_t data_rate(void) const {
+		return registers[RF_SETUP] & ((1<<RF_DR_LOW) | (1<<RF_DR_HIGH));
+	}
+
+	bool is_address(const uint8_t & reg) const {
+		return reg == RX_ADDR_P0 || reg == RX_ADDR_P1 || reg == TX_ADDR;
+	}
+
+	std::array<uint8_t, 5> & address(const uint8_t & reg){
+		return addresses[reg == TX_ADDR ? 2 : reg - RX_ADDR_P0];
+	}
+
+	uint8_t status(void) const {
+		uint8_t pipe = rx.count ? rx.pipes[0] : 0x07;
+		return (registers[NRF_STATUS] & ((1<<RX_DR) | (1<<TX_DS) | (1<<MAX_RT))) | (pipe << RX_P_NO) |
+		       (tx.count == 3 ? (1<<TX_FULL) : 0);
+	}
+
+	uint8_t fifo_status(void) const {
+		return (tx.count == 3 ? (1<<FIFO_FULL) : 0) | (tx.count == 0 ? (1<<TX_EMPTY) : 0) |
+		       (rx.count == 3 ? (1<<RX_FULL) : 0) | (rx.count == 0 ? (1<<RX_EMPTY) : 0);
+	}
+
+	uint8_t read(const uint8_t & reg, const uint8_t & index){
+		if(is_address(reg)){
+			return address(reg)[index];
+		}
+		if(reg == NRF_STATUS){
+			return status();
+		}
+		if(reg == FIFO_STATUS){
+			return fifo_status();
+		}
+		return registers[reg];
+	}
+
+	void write(const uint8_t & reg, const uint8_t & index, const uint8_t & value){
+		if(is_address(reg)){
+			address(reg)[index] = value;
+		}else if(index > 0){
+			return;
+		}else if(reg == NRF_STATUS){
+			// Writing a 1 clears the interrupt flag
+			registers[reg] &= ~(value & ((1<<RX_DR) | (1<<TX_DS) | (1<<MAX_RT)));
+		}else if(reg == RF_CH){
+			registers[reg] = value & 0x7F;
+		}else if(reg != OBSERVE_TX && reg != RPD && reg != FIFO_STATUS){
+			registers[reg] = value;
+		}
+	}
+
+	bool listening(void) const {
+		return (registers[NRF_CONFIG] & (1<<PWR_UP)) && (registers[NRF_CONFIG] & (1<<PRIM_RX));
+	}
+
+	/*
+	* Take a payload from the air, returns the pipe that accepted it or 0xFF
+	*/
+	uint8_t accept(const uint8_t & channel, const uint8_t & rate, const uint8_t & width, const std::array<uint8_t, 5> & tx_address,
+	               const uint8_t * data, const uint8_t & length){
+		if(!listening() || channel != registers[RF_CH] || rate != data_rate() || width != address_width()){
+			return 0xFF;
+		}
+		for(uint8_t pipe = 0; pipe < 6; pipe++){
+			if(!(registers[EN_RXADDR] & (1<<pipe))){
+				continue;
+			}
+			// Pipes 2-5 share the upper address bytes of pipe 1
+			std::array<uint8_t, 5> pipe_address = addresses[pipe == 0 ? 0 : 1];
+			if(pipe > 1){
+				pipe_address[0] = registers[RX_ADDR_P0 + pipe];
+			}
+			if(!std::equal(tx_address.begin(), tx_address.begin() + width, pipe_address.begin())){
+				continue;
+			}
+			bool dynamic = (registers[FEATURE] & (1<<EN_DPL)) && (registers[DYNPD] & (1<<pipe));
+			uint8_t size = dynamic ? length : std::min(registers[RX_PW_P0 + pipe], uint8_t(32));
+			if(size == 0 || !rx.push(data, size, pipe, false)){
+				overflows++;
+				return 0xFF;
+			}
+			registers[NRF_STATUS] |= (1<<RX_DR);
+			registers[RPD] = 1;
+			recieved++;
+			return pipe;
+		}
+		return 0xFF;
+	}
+
+	void transmit(void){
+		// MAX_RT has to be cleared before the next payload is sent
+		while(tx.count && !(registers[NRF_STATUS] & (1<<MAX_RT)) &&
+		      (registers[NRF_CONFIG] & (1<<PWR_UP)) && !(registers[NRF_CONFIG] & (1<<PRIM_RX))){
+			uint8_t pipe = 0xFF;
+			if(peer != nullptr){
+				pipe = peer->accept(registers[RF_CH], data_rate(), address_width(), addresses[2], tx.payloads[0].begin(), tx.lengths[0]);
+			}
+			if(pipe == 0xFF && !tx.no_ack[0] && (registers[EN_AA] & (1<<ENAA_P0))){
+				registers[NRF_STATUS] |= (1<<MAX_RT);
+				return;
+			}
+			tx.pop();
+			sent++;
+			registers[NRF_STATUS] |= (1<<TX_DS);
+		}
+	}
+
+public:
+	using hwlib::spi_bus::write_and_read;
+
+	/**
+	* \brief
+	* The emulator constructor
+	* \details
+	* The registers start with the power on reset values of the chip.
+	*/
+	rf24_emulator(void){
+		reset();
+	}
+
+	/**
+	* \brief
+	* Set the registers and addresses to the power on reset values and empty the FIFOs
+	*/
+	void reset(void){
+		registers = {0};
+		registers[NRF_CONFIG] = 0x08;
+		registers[EN_AA] = 0x3F;
+		registers[EN_RXADDR] = 0x03;
+		registers[SETUP_AW] = 0x03;
+		registers[SETUP_RETR] = 0x03;
+		registers[RF_CH] = 0x02;
+		registers[RF_SETUP] = 0x0E;
+		registers[RX_ADDR_P2] = 0xC3;
+		registers[RX_ADDR_P3] = 0xC4;
+		registers[RX_ADDR_P4] = 0xC5;
+		registers[RX_ADDR_P5] = 0xC6;
+		addresses[0] = {0xE7, 0xE7, 0xE7, 0xE7, 0xE7};
+		addresses[1] = {0xC2, 0xC2, 0xC2, 0xC2, 0xC2};
+		addresses[2] = {0xE7, 0xE7, 0xE7, 0xE7, 0xE7};
+		rx.count = 0;
+		tx.count = 0;
+	}
+
+	/**
+	* \brief
+	* Connect two emulators, payloads sent by one are recieved by the other
+	*/
+	void connect(rf24_emulator & other){
+		peer = &other;
+		other.peer = this;
+	}
+
+	/**
+	* \brief
+	* Put a payload in the RX FIFO as if it was recieved
+	* @returns False if the RX FIFO was full
+	*/
+	bool inject(const uint8_t & pipe, const uint8_t * data, const uint8_t & length){
+		if(!rx.push(data, std::min(length, uint8_t(32)), pipe, false)){
+			overflows++;
+			return 0;
+		}
+		registers[NRF_STATUS] |= (1<<RX_DR);
+		recieved++;
+		return 1;
+	}
+
+	/**
+	* \brief
+	* Handle one SPI transaction
+	* \details
+	* data_in may be the same buffer as data_out.
+	*/
+	void write_and_read(hwlib::pin_out & sel, const size_t n, const uint8_t data_out[], uint8_t data_in[]) override {
+		sel.set(0);
+		transactions++;
+		std::array<uint8_t, 33> out = {0};
+		std::array<uint8_t, 33> response = {0};
+		size_t length = std::min(n, out.size());
+		if(data_out != nullptr){
+			std::copy(data_out, data_out + length, out.begin());
+		}else{
+			out[0] = RF24_NOP;
+		}
+		uint8_t command = out[0];
+		response[0] = status();
+		if(command < W_REGISTER){
+			for(size_t i = 1; i < length; i++){
+				response[i] = read(command & 0x1F, i - 1);
+			}
+		}else if(command < W_REGISTER + 0x20){
+			for(size_t i = 1; i < length; i++){
+				write(command & 0x1F, i - 1, out[i]);
+			}
+		}else if(command == R_RX_PL_WID){
+			response[1] = rx.count ? rx.lengths[0] : 0;
+		}else if(command == R_RX_PAYLOAD){
+			for(size_t i = 1; i < length; i++){
+				response[i] = rx.count ? rx.payloads[0][i - 1] : 0;
+			}
+			rx.pop();
+		}else if(command == W_TX_PAYLOAD || command == W_TX_PAYLOAD_NO_ACK){
+			if(length > 1){
+				tx.push(out.begin() + 1, length - 1, 0, command == W_TX_PAYLOAD_NO_ACK);
+			}
+		}else if(command == FLUSH_TX){
+			tx.count = 0;
+		}else if(command == FLUSH_RX){
+			rx.count = 0;
+		}
+		transmit();
+		if(data_in != nullptr){
+			std::copy(response.begin(), response.begin() + length, data_in);
+			for(size_t i = length; i < n; i++){
+				data_in[i] = 0;
+			}
+		}
+		sel.set(1);
+	}
+
+	/**
+	* \brief
+	* Get the level of the IRQ pin
+	* \details
+	* The IRQ pin is active low, it is low while RX_DR, TX_DS or MAX_RT is set and not masked in CONFIG.
+	*/
+	bool irq(void) const {
+		// The MASK bits in CONFIG are at the same positions as the flags in STATUS
+		return !(registers[NRF_STATUS] & ~registers[NRF_CONFIG] & ((1<<RX_DR) | (1<<TX_DS) | (1<<MAX_RT)));
+	}
+
+	/**
+	* \brief
+	* Get the amount of SPI transactions
+	*/
+	uint32_t get_transactions(void) const {
+		return transactions;
+	}
+
+	/**
+	* \brief
+	* Print the statistics of the emulator
+	*/
+	void print_statistics(void) const {
+		hwlib::cout << "Emulator transactions=" << hwlib::dec << transactions
+					<< " sent=" << sent
+					<< " recieved=" << recieved
+					<< " overflows=" << overflows << '\n';
+	}
+};
+
+/**
+ * \brief
+ * IRQ pin of an emulated radio
+ * @code
+ * rf24_emulator air;
+ * rf24_emulator_irq irq(air);
+ * async_radio.set_irq(irq);
+ * @endcode
+ */
+class rf24_emulator_irq : public hwlib::pin_in
+{
+private:
+	const rf24_emulator & radio;
+
+public:
+	rf24_emulator_irq(const rf24_emulator & radio):
+		radio(radio)
+	{}
+
+	bool get(hwlib::buffering = hwlib::buffering::unbuffered) override {
+		return radio.irq();
+	}
+};
+
+#endif // RF24_EMULATOR_HPP
@@ -0,0 +1,272 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef RF24_LOG_HPP
+#define RF24_LOG_HPP
+#include "hwlib.hpp"
+#include "nrf24l01.hpp"
+#include "rf24_snapshot.hpp"
+/**
+ * @file rf24_log.hpp
+ */
+
+/// The first byte of every log record
+const uint8_t log_sync = 0xA5;
+/// The maximum size of the data in a log record
+const uint8_t log_max_data = 64;
+/// The size of the header of a packet record: timestamp, channel, pipe and length
+const uint8_t log_packet_header = 7;
+/// The size of the header of a capture record: timestamp and channel
+const uint8_t log_capture_header = 5;
+
+/**
+ * \brief
+ * Types of log records
+ */
+enum log_record_type: uint8_t{
+	log_snapshot	= 0x01,
+	log_packet		= 0x02,
+	log_capture		= 0x03
+};
+
+/**
+ * \brief
+ * A log record
+ * \details
+ * On the wire a record is the sync byte, the type, the length, the data and a checksum,
+ * the checksum is the xor of the type, the length and the data.
+ */
+struct log_record{
+	uint8_t type;
+	uint8_t length;
+	uint8_t data[log_max_data];
+
+	/**
+	* \brief
+	* Read a 32 bit value (LSB first) from the data
+	*/
+	uint32_t get32(const uint8_t & offset) const {
+		return uint32_t(data[offset]) | (uint32_t(data[offset + 1]) << 8) |
+		       (uint32_t(data[offset + 2]) << 16) | (uint32_t(data[offset + 3]) << 24);
+	}
+};
+
+/**
+ * \brief
+ * Frame a log record into a buffer
+ * @param out		The buffer, at least length + 4 bytes
+ * @param type		The record type
+ * @param data		The data of the record
+ * @param length	The size of the data, at most log_max_data
+ * @returns The size of the framed record
+ */
+inline uint8_t log_encode(uint8_t * out, const uint8_t & type, const uint8_t * data, const uint8_t & length){
+	uint8_t checksum = type ^ length;
+	out[0] = log_sync;
+	out[1] = type;
+	out[2] = length;
+	for(uint8_t i = 0; i < length; i++){
+		out[3 + i] = data[i];
+		checksum ^= data[i];
+	}
+	out[3 + length] = checksum;
+	return length + 4;
+}
+
+/**
+ * \brief
+ * Frame a packet record into a buffer
+ * @param out			The buffer, at least log_packet_header + 36 bytes
+ * @param timestamp_us	The time the packet has been recieved
+ * @param channel		The channel the packet has been recieved on
+ * @param pipe			The pipe the packet has been recieved on
+ * @param data			The payload
+ * @param length		The size of the payload, at most 32 bytes
+ * @returns The size of the framed record
+ */
+inline uint8_t log_encode_packet(uint8_t * out, const uint32_t & timestamp_us, const uint8_t & channel, const uint8_t & pipe,
+                                 const uint8_t * data, const uint8_t & length){
+	std::array<uint8_t, log_packet_header + 32> record;
+	uint8_t size = std::min(length, uint8_t(32));
+	for(uint8_t i = 0; i < 4; i++){
+		record[i] = uint8_t(timestamp_us >> (8 * i));
+	}
+	record[4] = channel;
+	record[5] = pipe;
+	record[6] = size;
+	for(uint8_t i = 0; i < size; i++){
+		record[log_packet_header + i] = data[i];
+	}
+	return log_encode(out, log_packet, record.begin(), log_packet_header + size);
+}
+
+/**
+ * \brief
+ * Writer of a binary log to the serial console
+ * \details
+ * The board only sends compact records, the host tool in tools/rf24_decode decodes them.
+ * @code
+ * rf24_log_writer log;
+ * log.write_snapshot(radio.snapshot());
+ * radio.read(frame);
+ * log.write_packet(hwlib::now_us(), radio.get_channel(), 1, frame.begin(), frame.size());
+ * @endcode
+ */
+class rf24_log_writer
+{
+private:
+	hwlib::ostream & out;
+
+public:
+	/**
+	* \brief
+	* The log writer constructor
+	* @param out	The stream to write to, the serial console by default
+	*/
+	rf24_log_writer(hwlib::ostream & out = hwlib::cout):
+		out(out)
+	{}
+
+	/**
+	* \brief
+	* Write a record
+	*/
+	void write_record(const uint8_t & type, const uint8_t * data, const uint8_t & length){
+		std::array<uint8_t, log_max_data + 4> record;
+		uint8_t size = log_encode(record.begin(), type, data, std::min(length, log_max_data));
+		for(uint8_t i = 0; i < size; i++){
+			out << char(record[i]);
+		}
+		out << hwlib::flush;
+	}
+
+	/**
+	* \brief
+	* Write a register snapshot
+	*/
+	void write_snapshot(const rf24_snapshot & snapshot){
+		write_record(log_snapshot, reinterpret_cast<const uint8_t *>(&snapshot), sizeof(snapshot));
+	}
+
+	/**
+	* \brief
+	* Write a recieved packet
+	* @param timestamp_us	The time the packet has been recieved
+	* @param channel		The channel the packet has been recieved on
+	* @param pipe			The pipe the packet has been recieved on
+	* @param data			The payload
+	* @param length			The size of the payload, at most 32 bytes
+	*/
+	void write_packet(const uint32_t & timestamp_us, const uint8_t & channel, const uint8_t & pipe,
+	                  const uint8_t * data, const uint8_t & length){
+		std::array<uint8_t, log_packet_header + 36> record;
+		uint8_t size = log_encode_packet(record.begin(), timestamp_us, channel, pipe, data, length);
+		for(uint8_t i = 0; i < size; i++){
+			out << char(record[i]);
+		}
+		out << hwlib::flush;
+	}
+
+	/**
+	* \brief
+	* Write a raw captured frame
+	* @param timestamp_us	The time the frame has been captured
+	* @param channel		The channel the frame has been captured on
+	* @param frame			The 32 raw bytes, see rf24::start_capture()
+	*/
+	void write_capture(const uint32_t & timestamp_us, const uint8_t & channel, const std::array<uint8_t, 32> & frame){
+		std::array<uint8_t, log_capture_header + 32> record;
+		for(uint8_t i = 0; i < 4; i++){
+			record[i] = uint8_t(timestamp_us >> (8 * i));
+		}
+		record[4] = channel;
+		for(uint8_t i = 0; i < 32; i++){
+			record[log_capture_header + i] = frame[i];
+		}
+		write_record(log_capture, record.begin(), record.size());
+	}
+};
+
+/**
+ * \brief
+ * Parser of a binary log
+ * \details
+ * Feed the parser one byte at a time, bytes that are not part of a valid record are skipped.
+ * @code
+ * rf24_log_parser parser;
+ * if(parser.feed(byte)){
+ * 	const log_record & record = parser.record();
+ * }
+ * @endcode
+ */
+class rf24_log_parser
+{
+private:
+	log_record current;
+	uint8_t position = 0;
+	uint8_t checksum = 0;
+	uint32_t errors = 0;
+
+public:
+	/**
+	* \brief
+	* Feed the next byte of the log
+	* @returns True if a complete record with a correct checksum has been parsed
+	*/
+	bool feed(const uint8_t & byte){
+		if(position == 0){
+			position = (byte == log_sync) ? 1 : 0;
+			return 0;
+		}
+		if(position == 1){
+			current.type = byte;
+			checksum = byte;
+			position++;
+			return 0;
+		}
+		if(position == 2){
+			if(byte > log_max_data){
+				errors++;
+				position = (byte == log_sync) ? 1 : 0;
+				return 0;
+			}
+			current.length = byte;
+			checksum ^= byte;
+			position++;
+			return 0;
+		}
+		uint8_t index = position - 3;
+		if(index < current.length){
+			current.data[index] = byte;
+			checksum ^= byte;
+			position++;
+			return 0;
+		}
+		position = 0;
+		if(byte != checksum){
+			errors++;
+			return 0;
+		}
+		return 1;
+	}
+
+	/**
+	* \brief
+	* Get the last parsed record
+	*/
+	const log_record & record(void) const {
+		return current;
+	}
+
+	/**
+	* \brief
+	* Get the amount of records with an invalid length or checksum
+	*/
+	uint32_t invalid(void) const {
+		return errors;
+	}
+};
+
+#endif // RF24_LOG_HPP
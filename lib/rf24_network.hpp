@@ -0,0 +1,356 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef RF24_NETWORK_HPP
+#define RF24_NETWORK_HPP
+#include "rf24.hpp"
+#include "hwlib.hpp"
+/**
+ * @file rf24_network.hpp
+ */
+
+/**
+ * \brief
+ * Header in front of every network frame
+ * \details
+ * Node addresses are written in octal, every digit is one level in the tree.
+ * Node 00 is the gateway, 01-07 are its children, 011-071 are the children of node 01 and so on.
+ */
+struct network_header{
+	uint16_t to = 0;
+	uint16_t from = 0;
+	uint8_t id = 0;
+	uint8_t type = 0;
+	uint8_t length = 0;
+	uint8_t hops = 0;
+};
+
+/**
+ * \brief
+ * Maximum amount of payload bytes in a network frame
+ */
+const uint8_t network_payload_size = 32 - sizeof(network_header);
+
+/**
+ * \brief
+ * A complete network frame, this is exactly one 32 byte radio payload
+ */
+struct network_frame{
+	network_header header;
+	std::array<uint8_t, network_payload_size> payload = {0};
+};
+static_assert(sizeof(network_frame) == 32, "A network frame must be exactly one radio payload");
+
+/**
+ * \brief
+ * Network statistics
+ */
+struct network_statistics{
+	uint32_t sent = 0;
+	uint32_t send_failed = 0;
+	uint32_t recieved = 0;
+	uint32_t forwarded = 0;
+	uint32_t forward_failed = 0;
+	uint32_t dropped = 0;
+	uint32_t forward_time_us = 0;
+};
+
+/**
+ * \brief
+ * Tree network layer with multi-hop forwarding
+ * \details
+ * Every node recieves on pipe 1 with a 5-byte pipe address derived from its logical node address.
+ * Frames for other nodes are stored in a fixed forward queue and send to the next hop on the next call to poll().
+ * The next hop is taken from the routing table, when there is no route the tree structure of the address is used:
+ * frames for a descendant go to the child on the path, all other frames go to the parent.
+ * All memory is allocated statically by the template parameters.
+ * @code
+ * rf24_network<> network(radio, 011);
+ * network.begin();
+ * network.write(00, 'T', data);
+ * for(;;){
+ * 	network.poll();
+ * }
+ * @endcode
+ * @note Call begin() on the radio first, the network uses the dynamic payload and auto acknowledge settings of begin()
+ */
+template<size_t routes = 8, size_t queue_size = 4>
+class rf24_network
+{
+private:
+	struct route{
+		uint16_t destination;
+		uint16_t next_hop;
+	};
+
+	rf24 & radio;
+	uint16_t node_address;
+	uint8_t max_hops;
+	uint8_t next_id = 0;
+	std::array<route, routes> table;
+	size_t route_count = 0;
+
+	std::array<network_frame, queue_size> forward_queue;
+	std::array<uint32_t, queue_size> forward_arrival;
+	size_t forward_head = 0;
+	size_t forward_count = 0;
+
+	std::array<network_frame, queue_size> inbound_queue;
+	size_t inbound_head = 0;
+	size_t inbound_count = 0;
+
+	network_statistics stats;
+
+	bool transmit(const network_frame & frame, const uint16_t & next){
+		radio.enter_tx_mode();
+		// Pipe 0 recieves the acknowledge from the next hop
+		radio.enable_pipe(0);
+		radio.set_transmit_address(pipe_address(next));
+		bool result = radio.write(frame) && radio.wait_for_transmission();
+		// Do not recieve frames for the next hop on pipe 0
+		radio.disable_pipe(0);
+		radio.enter_rx_mode();
+		return result;
+	}
+
+	void recieve(void){
+		while(radio.data_available()){
+			network_frame frame;
+			radio.read(frame);
+			if(frame.header.to == node_address){
+				if(inbound_count < queue_size){
+					inbound_queue[(inbound_head + inbound_count) % queue_size] = frame;
+					inbound_count++;
+					stats.recieved++;
+				}else{
+					stats.dropped++;
+				}
+			}else if(forward_count < queue_size && frame.header.hops < max_hops){
+				size_t index = (forward_head + forward_count) % queue_size;
+				frame.header.hops++;
+				forward_queue[index] = frame;
+				forward_arrival[index] = hwlib::now_us();
+				forward_count++;
+			}else{
+				stats.dropped++;
+			}
+		}
+	}
+
+public:
+	/**
+	* \brief
+	* The network constructor
+	* @param radio			The radio used by the network
+	* @param node_address	The logical address of this node (octal)
+	* @param max_hops		Frames which have been forwarded this many times are dropped
+	*/
+	rf24_network(rf24 & radio, const uint16_t & node_address, const uint8_t & max_hops = 5):
+		radio(radio),
+		node_address(node_address),
+		max_hops(max_hops)
+	{}
+
+	/**
+	* \brief
+	* Get the pipe address of a node
+	*/
+	static std::array<uint8_t, 5> pipe_address(const uint16_t & node){
+		// Mix the node address so that no address byte is 0x00 or a preamble-like 0x55/0xAA
+		return {uint8_t((node & 0xFF) ^ 0xC3), uint8_t((node >> 8) ^ 0x3C), 0xB3, 0xB4, 0xB5};
+	}
+
+	/**
+	* \brief
+	* Get the level of a node in the tree, the gateway is level 0
+	*/
+	static uint8_t level(const uint16_t & node){
+		uint8_t result = 0;
+		while(result < 5 && (node >> (3 * result))){
+			result++;
+		}
+		return result;
+	}
+
+	/**
+	* \brief
+	* Get the parent of a node
+	*/
+	static uint16_t parent(const uint16_t & node){
+		uint8_t l = level(node);
+		if(l == 0){
+			return 0;
+		}
+		return node & ((1 << (3 * (l - 1))) - 1);
+	}
+
+	/**
+	* \brief
+	* Begin operation of the network
+	* \details
+	* Sets the recieving address of this node and puts the radio in RX mode
+	*/
+	void begin(void){
+		radio.set_recieve_address(1, pipe_address(node_address));
+		radio.enable_pipe(1);
+		radio.disable_pipe(0);
+		radio.start_listening();
+	}
+
+	/**
+	* \brief
+	* Add a static route
+	* @returns False if the routing table is full
+	*/
+	bool add_route(const uint16_t & destination, const uint16_t & next_hop){
+		for(size_t i = 0; i < route_count; i++){
+			if(table[i].destination == destination){
+				table[i].next_hop = next_hop;
+				return 1;
+			}
+		}
+		if(route_count >= routes){
+			return 0;
+		}
+		table[route_count++] = {destination, next_hop};
+		return 1;
+	}
+
+	/**
+	* \brief
+	* Get the next hop towards a destination
+	*/
+	uint16_t next_hop(const uint16_t & destination) const {
+		for(size_t i = 0; i < route_count; i++){
+			if(table[i].destination == destination){
+				return table[i].next_hop;
+			}
+		}
+		uint8_t own_level = level(node_address);
+		uint16_t own_mask = (1 << (3 * own_level)) - 1;
+		// If the destination is a descendant, send to the child on the path
+		if(level(destination) > own_level && (destination & own_mask) == node_address){
+			return destination & ((1 << (3 * (own_level + 1))) - 1);
+		}
+		return parent(node_address);
+	}
+
+	/**
+	* \brief
+	* Send data to a node
+	* @param to		The logical address of the destination
+	* @param type	Application defined frame type
+	* @param d		The data to be send, at most network_payload_size bytes
+	* @returns True if the frame has been acknowledged by the next hop
+	*/
+	template<typename datatype>
+	bool write(const uint16_t & to, const uint8_t & type, const datatype & d){
+		static_assert(sizeof(d) <= network_payload_size, "Data does not fit in a network frame");
+		network_frame frame;
+		frame.header.to = to;
+		frame.header.from = node_address;
+		frame.header.id = next_id++;
+		frame.header.type = type;
+		frame.header.length = sizeof(d);
+		const uint8_t * data = reinterpret_cast<const uint8_t *>(&d);
+		for(uint8_t i = 0; i < sizeof(d); i++){
+			frame.payload[i] = data[i];
+		}
+		bool result = transmit(frame, next_hop(to));
+		if(result){
+			stats.sent++;
+		}else{
+			stats.send_failed++;
+		}
+		return result;
+	}
+
+	/**
+	* \brief
+	* Recieve frames and forward the queued frames
+	* \details
+	* Call this function often, relays only forward frames from within this function.
+	*/
+	void poll(void){
+		recieve();
+		while(forward_count > 0){
+			const network_frame & frame = forward_queue[forward_head];
+			if(transmit(frame, next_hop(frame.header.to))){
+				stats.forwarded++;
+				stats.forward_time_us += hwlib::now_us() - forward_arrival[forward_head];
+			}else{
+				stats.forward_failed++;
+			}
+			forward_head = (forward_head + 1) % queue_size;
+			forward_count--;
+			// Frames may have arrived while transmitting
+			recieve();
+		}
+	}
+
+	/**
+	* \brief
+	* Check if a frame for this node is available
+	*/
+	bool available(void) const {
+		return inbound_count > 0;
+	}
+
+	/**
+	* \brief
+	* Read a frame for this node
+	* @param[in] d	The variable where the payload is to be stored into
+	* @returns The header of the frame
+	*/
+	template<typename datatype>
+	network_header read(datatype & d){
+		network_header header;
+		if(inbound_count == 0){
+			return header;
+		}
+		const network_frame & frame = inbound_queue[inbound_head];
+		header = frame.header;
+		uint8_t * data = reinterpret_cast<uint8_t *>(&d);
+		for(uint8_t i = 0; i < std::min(sizeof(d), size_t(network_payload_size)); i++){
+			data[i] = frame.payload[i];
+		}
+		inbound_head = (inbound_head + 1) % queue_size;
+		inbound_count--;
+		return header;
+	}
+
+	/**
+	* \brief
+	* Get the logical address of this node
+	*/
+	uint16_t address(void) const {
+		return node_address;
+	}
+
+	/**
+	* \brief
+	* Get the network statistics
+	*/
+	const network_statistics & statistics(void) const {
+		return stats;
+	}
+
+	/**
+	* \brief
+	* Print the network statistics
+	*/
+	void print_statistics(void) const {
+		hwlib::cout << "Node 0" << hwlib::oct << node_address << hwlib::dec
+					<< "\tsent=" << stats.sent << " failed=" << stats.send_failed
+					<< " recieved=" << stats.recieved << " forwarded=" << stats.forwarded
+					<< " forward_failed=" << stats.forward_failed << " dropped=" << stats.dropped;
+		if(stats.forwarded){
+			hwlib::cout << " forward_latency=" << stats.forward_time_us / stats.forwarded << "us";
+		}
+		hwlib::cout << '\n';
+	}
+};
+
+#endif // RF24_NETWORK_HPP
@@ -0,0 +1,137 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef RF24_SNAPSHOT_HPP
+#define RF24_SNAPSHOT_HPP
+#include "hwlib.hpp"
+#include "nrf24l01.hpp"
+/**
+ * @file rf24_snapshot.hpp
+ */
+
+/// The amount of one byte registers in a snapshot, 0x00 up to and including FEATURE
+const uint8_t snapshot_registers = FEATURE + 1;
+
+/**
+ * \brief
+ * Copy of the register file of the radio
+ * \details
+ * Taken by rf24::snapshot(). The struct only contains bytes, so it can be send as is over the serial console
+ * and decoded on the host with the formatters below.
+ * For the five byte address registers, registers[] holds the first byte.
+ */
+struct rf24_snapshot{
+	uint8_t status;
+	uint8_t registers[snapshot_registers];
+	uint8_t rx_addr_p0[5];
+	uint8_t rx_addr_p1[5];
+	uint8_t tx_addr[5];
+};
+
+static_assert(sizeof(rf24_snapshot) == 46, "rf24_snapshot must not contain padding");
+
+/**
+ * \brief
+ * Get the data rate of a snapshot
+ * @returns rf24_1mbps, rf24_2mbps or rf24_250kbps
+ */
+inline uint8_t snapshot_data_rate(const rf24_snapshot & snapshot){
+	uint8_t setup = snapshot.registers[RF_SETUP];
+	if(setup & (1<<RF_DR_LOW)){
+		return rf24_250kbps;
+	}
+	return (setup & (1<<RF_DR_HIGH)) ? rf24_2mbps : rf24_1mbps;
+}
+
+/**
+ * \brief
+ * Get the power level of a snapshot
+ * @returns pwr_min up to and including pwr_max
+ */
+inline uint8_t snapshot_power_level(const rf24_snapshot & snapshot){
+	return (snapshot.registers[RF_SETUP] >> 1) & 0x03;
+}
+
+/**
+ * \brief
+ * Get the CRC length of a snapshot
+ * @returns rf24_crc_disabled, rf24_crc_8 or rf24_crc_16
+ */
+inline uint8_t snapshot_crc_length(const rf24_snapshot & snapshot){
+	uint8_t config = snapshot.registers[NRF_CONFIG];
+	if(!(config & (1<<EN_CRC))){
+		return rf24_crc_disabled;
+	}
+	return (config & (1<<CRCO)) ? rf24_crc_16 : rf24_crc_8;
+}
+
+/**
+ * \brief
+ * Print the STATUS register
+ */
+inline void print_snapshot_status(hwlib::ostream & out, const uint8_t & status){
+	out << "STATUS\t\t =" <<
+	" RX_DR=" << ((status & (1<<RX_DR))?1:0) <<
+	" TX_DS=" << ((status & (1<<TX_DS))?1:0) <<
+	" MAX_RT=" << ((status & (1<<MAX_RT))?1:0) <<
+	" RX_P_NO=" << ((status >> RX_P_NO) & 0x07) <<
+	" TX_FULL=" << ((status & (1<<TX_FULL))?1:0) << '\n';
+}
+
+/**
+ * \brief
+ * Print a five byte address
+ */
+inline void print_snapshot_address(hwlib::ostream & out, const uint8_t address[5]){
+	out << "0x";
+	for(uint8_t j = 0; j<5; j++){
+		out << hwlib::hex << address[j];
+	}
+	out << " ";
+}
+
+/**
+ * \brief
+ * Print one byte registers of a snapshot
+ */
+inline void print_snapshot_bytes(hwlib::ostream & out, const char * name, const rf24_snapshot & snapshot,
+                                 const uint8_t & reg, const uint8_t & qty = 1){
+	out << name << "\t = ";
+	for(uint8_t i = 0; i<qty; i++){
+		out << "0x" << hwlib::hex << snapshot.registers[reg + i] << " ";
+	}
+	out << '\n';
+}
+
+/**
+ * \brief
+ * Print a snapshot in the same format as rf24::print_details()
+ */
+inline void print_snapshot(hwlib::ostream & out, const rf24_snapshot & snapshot){
+	out << "NRF24L01+ configuration\n\n";
+	print_snapshot_status(out, snapshot.status);
+
+	out << "RX_ADDR_P0-1\t = ";
+	print_snapshot_address(out, snapshot.rx_addr_p0);
+	print_snapshot_address(out, snapshot.rx_addr_p1);
+	out << '\n';
+	print_snapshot_bytes(out, "RX_ADDR_P2-5", snapshot, RX_ADDR_P2, 4);
+	out << "TX_ADDR\t\t = ";
+	print_snapshot_address(out, snapshot.tx_addr);
+	out << '\n';
+
+	print_snapshot_bytes(out, "RX_PW_P0-5", snapshot, RX_PW_P0, 6);
+	print_snapshot_bytes(out, "EN_AA\t", snapshot, EN_AA);
+	print_snapshot_bytes(out, "EN_RXADDR", snapshot, EN_RXADDR);
+	print_snapshot_bytes(out, "SETUP_AW", snapshot, SETUP_AW);
+	print_snapshot_bytes(out, "SETUP_RETR", snapshot, SETUP_RETR);
+	print_snapshot_bytes(out, "RF_CH\t", snapshot, RF_CH);
+	print_snapshot_bytes(out, "RF_SETUP", snapshot, RF_SETUP);
+	print_snapshot_bytes(out, "CONFIG\t", snapshot, NRF_CONFIG);
+	print_snapshot_bytes(out, "DYNPD/FEATURE", snapshot, DYNPD, 2);
+	out << '\n';
+}
+
+#endif // RF24_SNAPSHOT_HPP
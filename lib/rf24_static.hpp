@@ -0,0 +1,282 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef RF24_STATIC_HPP
+#define RF24_STATIC_HPP
+#include "hwlib.hpp"
+#include "nrf24l01.hpp"
+/**
+ * @file rf24_static.hpp
+ */
+
+/**
+ * \brief
+ * Compile-time radio configuration
+ * \details
+ * All register values are calculated by the compiler from the template parameters.
+ * @param rate			rf24_250kbps, rf24_1mbps or rf24_2mbps
+ * @param crc			rf24_crc_disabled, rf24_crc_8 or rf24_crc_16
+ * @param address_width	Address width in bytes, value between 3-5
+ * @param dyn_payloads	Use a dynamic payload length instead of a fixed 32 byte payload
+ * @param auto_ack		Enable auto acknowledge and retransmissions on the enabled pipes
+ * @param pipes			Bitmask of the enabled recieve pipes (ERX_P0-ERX_P5)
+ * @param channel		Radio channel, value between 0-125
+ * @param level			pwr_min, pwr_low, pwr_high or pwr_max
+ */
+template<
+	uint8_t rate = rf24_1mbps,
+	uint8_t crc = rf24_crc_16,
+	uint8_t address_width = 5,
+	bool dyn_payloads = true,
+	bool auto_ack = true,
+	uint8_t pipes = (1<<ERX_P0) | (1<<ERX_P1),
+	uint8_t channel = 60,
+	uint8_t level = pwr_max
+>
+struct rf24_config
+{
+	static_assert(rate <= rf24_250kbps, "Invalid data rate");
+	static_assert(crc <= rf24_crc_16, "Invalid CRC length");
+	static_assert(address_width >= 3 && address_width <= 5, "Address width must be 3, 4 or 5 bytes");
+	static_assert(pipes != 0 && pipes < (1<<6), "Pipe mask must enable at least one of the 6 pipes");
+	static_assert(channel <= 125, "Channel must be between 0-125");
+	static_assert(level <= pwr_max, "Invalid power level");
+	// The chip forces the CRC on when auto acknowledge is enabled
+	static_assert(!auto_ack || crc != rf24_crc_disabled, "Auto acknowledge requires a CRC");
+	// The chip only accepts a dynamic payload length on a pipe with auto acknowledge (ENAA_Px)
+	static_assert(!dyn_payloads || auto_ack, "Dynamic payloads require auto acknowledge");
+
+	static constexpr uint8_t width = address_width;
+	static constexpr bool dynamic_payloads = dyn_payloads;
+	static constexpr bool acknowledge = auto_ack;
+
+	static constexpr uint8_t config =
+		(crc != rf24_crc_disabled ? (1<<EN_CRC) : 0) |
+		(crc == rf24_crc_16 ? (1<<CRCO) : 0) |
+		(1<<PWR_UP);
+	static constexpr uint8_t config_rx = config | (1<<PRIM_RX);
+	static constexpr uint8_t en_aa = auto_ack ? pipes : 0;
+	static constexpr uint8_t en_rxaddr = pipes;
+	static constexpr uint8_t setup_aw = (address_width - 2) << AW;
+	// Shortest retransmission delay which fits an ack payload at every data rate, 15 retries
+	static constexpr uint8_t setup_retr = auto_ack ? ((rate == rf24_250kbps ? 5 : 1) << ARD) | (15 << ARC) : 0;
+	static constexpr uint8_t rf_ch = channel;
+	static constexpr uint8_t rf_setup =
+		(rate == rf24_250kbps ? (1<<RF_DR_LOW) : 0) |
+		(rate == rf24_2mbps ? (1<<RF_DR_HIGH) : 0) |
+		(level << 1) | 1;
+	static constexpr uint8_t dynpd = dyn_payloads ? pipes : 0;
+	static constexpr uint8_t feature = dyn_payloads ? (1<<EN_DPL) : 0;
+	static constexpr uint8_t payload_width = dyn_payloads ? 0 : 32;
+
+	/**
+	* \brief
+	* Register image written by begin(), each entry is a {register, value} pair
+	*/
+	static constexpr std::array<std::array<uint8_t, 2>, 15> register_image = {{
+		{NRF_CONFIG, config},
+		{EN_AA, en_aa},
+		{EN_RXADDR, en_rxaddr},
+		{SETUP_AW, setup_aw},
+		{SETUP_RETR, setup_retr},
+		{RF_CH, rf_ch},
+		{RF_SETUP, rf_setup},
+		{RX_PW_P0, payload_width},
+		{RX_PW_P1, payload_width},
+		{RX_PW_P2, payload_width},
+		{RX_PW_P3, payload_width},
+		{RX_PW_P4, payload_width},
+		{RX_PW_P5, payload_width},
+		{FEATURE, feature},
+		{DYNPD, dynpd}
+	}};
+};
+
+template<uint8_t rate, uint8_t crc, uint8_t address_width, bool dyn_payloads, bool auto_ack, uint8_t pipes, uint8_t channel, uint8_t level>
+constexpr std::array<std::array<uint8_t, 2>, 15> rf24_config<rate, crc, address_width, dyn_payloads, auto_ack, pipes, channel, level>::register_image;
+
+/**
+ * \brief
+ * NRF24L01+ implementation with a compile-time configuration
+ * \details
+ * This is a reduced variant of rf24 for small nodes which never change their configuration.
+ * The configuration is a rf24_config type, so no configuration is kept in RAM and write() and read()
+ * do not have to check the payload mode at runtime.
+ * @code
+ * using node_config = rf24_config<rf24_250kbps, rf24_crc_8, 3>;
+ * rf24_static<node_config> radio(spi_bus, CE, CSN);
+ * radio.begin();
+ * radio.set_transmit_address({0xF1, 0xAB, 0xAB});
+ * radio.stop_listening();
+ * @endcode
+ */
+template<typename config>
+class rf24_static
+{
+private:
+	hwlib::spi_bus & bus;
+	hwlib::pin_out & ce;
+	hwlib::pin_out & csn;
+
+	void write_register(const uint8_t & reg, const uint8_t & data){
+		std::array<uint8_t, 2> input = {uint8_t(W_REGISTER + reg), data};
+		std::array<uint8_t, 2> dummy;
+		bus.write_and_read(csn, input, dummy);
+	}
+
+	void write_address(const uint8_t & reg, const std::array<uint8_t, config::width> & address){
+		std::array<uint8_t, config::width + 1> input;
+		std::array<uint8_t, config::width + 1> dummy;
+		input[0] = W_REGISTER + reg;
+		for(uint8_t i = 0; i < config::width; i++){
+			input[i+1] = address[i];
+		}
+		bus.write_and_read(csn, input, dummy);
+	}
+
+	uint8_t command(const uint8_t & cmd){
+		std::array<uint8_t, 1> input = {cmd};
+		std::array<uint8_t, 1> output;
+		bus.write_and_read(csn, input, output);
+		return output[0];
+	}
+
+public:
+	/**
+	* \brief
+	* The library constructor
+	* @param bus	The SPI-bus where the module is connected to
+	* @param ce		The Chip Enable pin
+	* @param csn	The Chip Select pin
+	*/
+	rf24_static(hwlib::spi_bus & bus, hwlib::pin_out & ce, hwlib::pin_out & csn):
+		bus(bus),
+		ce(ce),
+		csn(csn)
+	{}
+
+	/**
+	* \brief
+	* Begin operation of the chip
+	* \details
+	* Writes the complete register image of the configuration and powers up the chip in TX mode.
+	*/
+	void begin(void){
+		ce.set(0);
+		for(const auto & reg : config::register_image){
+			write_register(reg[0], reg[1]);
+		}
+		write_register(NRF_STATUS, (1<<RX_DR) | (1<<TX_DS) | (1<<MAX_RT));
+		command(FLUSH_TX);
+		command(FLUSH_RX);
+		// Wait for the oscillator to start up (Tpd2stby)
+		hwlib::wait_us(1500);
+	}
+
+	/**
+	* \brief
+	* Set transmission address
+	* \details
+	* Also sets RX address 0 to the same value for auto ack
+	*/
+	void set_transmit_address(const std::array<uint8_t, config::width> & address){
+		write_address(TX_ADDR, address);
+		write_address(RX_ADDR_P0, address);
+	}
+
+	/**
+	* \brief
+	* Set recieve address
+	* @param pipe		The pipe number. Value between 0-5
+	* @param address	The address (LSB first), only the first byte is used for pipes 2-5
+	*/
+	void set_recieve_address(const uint8_t & pipe, const std::array<uint8_t, config::width> & address){
+		if(pipe < 2){
+			write_address(RX_ADDR_P0 + pipe, address);
+		}else if(pipe < 6){
+			write_register(RX_ADDR_P0 + pipe, address[0]);
+		}
+	}
+
+	/**
+	* \brief
+	* Set radio in RX mode
+	*/
+	void start_listening(void){
+		write_register(NRF_CONFIG, config::config_rx);
+		write_register(NRF_STATUS, (1<<RX_DR) | (1<<TX_DS) | (1<<MAX_RT));
+		ce.set(1);
+	}
+
+	/**
+	* \brief
+	* Set radio in TX mode
+	*/
+	void stop_listening(void){
+		ce.set(0);
+		write_register(NRF_CONFIG, config::config);
+		command(FLUSH_TX);
+	}
+
+	/**
+	* \brief
+	* Check if there is data available to be read
+	* \details
+	* Uses the RX_P_NO field of the STATUS register, this is a single byte transaction.
+	*/
+	bool data_available(void){
+		return ((command(RF24_NOP) >> RX_P_NO) & 0x07) != 0x07;
+	}
+
+	/**
+	* \brief
+	* Write data to the TX FIFO
+	* @returns False if the previous transmission hit the maximum amount of retransmissions
+	*/
+	template<typename datatype>
+	bool write(const datatype & d){
+		static_assert(sizeof(d) <= 32, "Payload can not be larger than 32 bytes");
+		constexpr uint8_t length = config::dynamic_payloads ? sizeof(d) : 32;
+		std::array<uint8_t, length + 1> input = {0};
+		std::array<uint8_t, length + 1> output;
+		input[0] = W_TX_PAYLOAD;
+		const uint8_t * data = reinterpret_cast<const uint8_t *>(&d);
+		for(uint8_t i = 0; i < sizeof(d); i++){
+			input[i+1] = data[i];
+		}
+		bus.write_and_read(csn, input, output);
+		ce.set(1);
+		hwlib::wait_us(20);
+		ce.set(0);
+		if(config::acknowledge && (output[0] & (1<<MAX_RT))){
+			command(FLUSH_TX);
+			write_register(NRF_STATUS, (1<<MAX_RT));
+			return 0;
+		}
+		return 1;
+	}
+
+	/**
+	* \brief
+	* Read available data from RX FIFO
+	* \details
+	* Only sizeof(d) bytes are clocked out of the FIFO, the remainder of the payload is discarded by the chip.
+	*/
+	template<typename datatype>
+	void read(datatype & d){
+		static_assert(sizeof(d) <= 32, "Payload can not be larger than 32 bytes");
+		std::array<uint8_t, sizeof(d) + 1> input = {0};
+		std::array<uint8_t, sizeof(d) + 1> output;
+		input[0] = R_RX_PAYLOAD;
+		bus.write_and_read(csn, input, output);
+		uint8_t * data = reinterpret_cast<uint8_t *>(&d);
+		for(uint8_t i = 0; i < sizeof(d); i++){
+			data[i] = output[i+1];
+		}
+		write_register(NRF_STATUS, (1<<RX_DR));
+	}
+};
+
+#endif // RF24_STATIC_HPP
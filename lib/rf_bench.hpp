@@ -0,0 +1,546 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef RF_BENCH_HPP
+#define RF_BENCH_HPP
+#include "rf24.hpp"
+#include "rf24_network.hpp"
+#include "multi_radio.hpp"
+#include "shared_bus.hpp"
+#include "payload_codec.hpp"
+#include "batch.hpp"
+#include "secure.hpp"
+#include "ota.hpp"
+#include "power_monitor.hpp"
+#include "hwlib.hpp"
+/**
+ * @file rf_bench.hpp
+ */
+
+/**
+ * \brief
+ * RF24 benchmark class
+ * \details
+ * Like rf_test this class uses two radios attached to the same board,
+ * the results are printed to the terminal.
+ */
+class rf_bench
+{
+private:
+	rf24 & module01;
+	rf24 & module02;
+	power_monitor monitor;
+
+	void setup(void){
+		module01.begin();
+		module02.begin();
+		module01.set_power_level(pwr_low);
+		module02.set_power_level(pwr_low);
+		module01.set_data_rate(rf24_1mbps);
+		module02.set_data_rate(rf24_1mbps);
+	}
+
+	template<typename network>
+	bool wait_for_frame(network & node, const uint32_t & timeout_us){
+		uint64_t deadline = hwlib::now_us() + timeout_us;
+		while(!node.available()){
+			if(hwlib::now_us() > deadline){
+				return 0;
+			}
+			node.poll();
+		}
+		return 1;
+	}
+
+	void print_result(const char * name, const uint32_t & delivered, const uint32_t & count,
+	                  const uint64_t & latency_us, const uint64_t & duration_us, const uint32_t & bytes){
+		hwlib::cout << name << "\t delivered=" << hwlib::dec << delivered << "/" << count;
+		if(delivered && latency_us){
+			hwlib::cout << " latency=" << (uint32_t)(latency_us / delivered) << "us";
+		}
+		if(delivered){
+			hwlib::cout << " rate=" << (uint32_t)(uint64_t(delivered) * 1000000 / duration_us) << " frames/s"
+						<< " throughput=" << (uint32_t)(uint64_t(delivered) * bytes * 1000000 / duration_us) << " B/s";
+		}
+		hwlib::cout << '\n';
+	}
+
+public:
+	/**
+	* \brief
+	* The benchmark class constructor
+	* @param module01	The constructor for the first radio
+	* @param module02	The constructor for the second radio
+	*/
+	rf_bench(rf24 & module01, rf24 & module02):
+		module01(module01),
+		module02(module02)
+	{};
+
+	/**
+	* \brief
+	* Benchmark the network layer
+	* \details
+	* module02 is a relay (node 01) and module01 is a leaf (node 011).
+	* First frames are send from the leaf to the relay (one hop), then frames are send from the leaf to itself,
+	* which makes the relay forward them back to the leaf (two hops).
+	* The latency is the time from calling write() until the frame is available at the destination.
+	* @param count	The amount of frames for each measurement
+	*/
+	void bench_network(const uint16_t & count = 100){
+		hwlib::cout << "\nBenchmarking network layer\n";
+		setup();
+		rf24_network<> leaf(module01, 011);
+		rf24_network<> relay(module02, 01);
+		leaf.begin();
+		relay.begin();
+
+		uint32_t delivered = 0;
+		uint64_t latency = 0;
+		uint32_t value = 0;
+		uint64_t start = hwlib::now_us();
+		for(uint16_t i = 0; i < count; i++){
+			uint64_t sent = hwlib::now_us();
+			if(leaf.write(01, 0, i) && wait_for_frame(relay, 10000)){
+				relay.read(value);
+				latency += hwlib::now_us() - sent;
+				delivered++;
+			}
+		}
+		print_result("1 hop ", delivered, count, latency, hwlib::now_us() - start, network_payload_size);
+
+		delivered = 0;
+		latency = 0;
+		start = hwlib::now_us();
+		for(uint16_t i = 0; i < count; i++){
+			uint64_t sent = hwlib::now_us();
+			if(leaf.write(011, 0, i)){
+				relay.poll();
+				if(wait_for_frame(leaf, 10000)){
+					leaf.read(value);
+					latency += hwlib::now_us() - sent;
+					delivered++;
+				}
+			}
+		}
+		print_result("2 hops", delivered, count, latency, hwlib::now_us() - start, network_payload_size);
+		leaf.print_statistics();
+		relay.print_statistics();
+	}
+
+	/**
+	* \brief
+	* Benchmark the multi radio manager
+	* \details
+	* module01 is a transmitter and module02 a reciever in one multi_radio, this is the full duplex setup
+	* of a node with two radios. The transmitter is handed the next frame as soon as it is free and the reciever
+	* is serviced in between, instead of waiting for each transmission to finish.
+	* @param count	The amount of frames to send
+	*/
+	void bench_multi_radio(const uint16_t & count = 100){
+		hwlib::cout << "\nBenchmarking multi radio manager\n";
+		setup();
+		module01.set_transmit_address({0xFF,0xAB,0xAB,0xAB,0xAB});
+		module02.set_transmit_address({0xFF,0xAB,0xAB,0xAB,0xAB});
+		multi_radio<2> radios({&module01, &module02});
+		radios.set_role(1, role_rx);
+		radios.begin();
+
+		std::array<uint8_t, 32> frame = {0};
+		uint32_t delivered = 0;
+		uint16_t sent = 0;
+		size_t index;
+		uint64_t start = hwlib::now_us();
+		while(sent < count || radios.service() > 0){
+			if(sent < count && radios.write(frame)){
+				sent++;
+			}
+			while(radios.poll(index)){
+				radios.read(index, frame);
+				delivered++;
+			}
+		}
+		// Collect the last frame
+		hwlib::wait_us(500);
+		while(radios.poll(index)){
+			radios.read(index, frame);
+			delivered++;
+		}
+		print_result("tx+rx ", delivered, count, 0, hwlib::now_us() - start, 32);
+		radios.print_statistics();
+	}
+
+	/**
+	* \brief
+	* Benchmark the aggregate packet rate of radios on one SPI bus
+	* \details
+	* Connect both radios to the same SPI bus for this benchmark. Both radios transmit without acknowledge
+	* on their own channel, first module01 alone and then both radios through one shared_bus_scheduler.
+	* @param count	The amount of frames per radio
+	*/
+	void bench_shared_bus(const uint16_t & count = 200){
+		hwlib::cout << "\nBenchmarking radios on a shared SPI bus\n";
+		setup();
+		module01.set_channel(100);
+		module02.set_channel(110);
+		module01.stop_listening();
+		module02.stop_listening();
+		std::array<uint8_t, 32> frame = {0};
+
+		shared_bus_scheduler<1> one({&module01}, true);
+		uint64_t start = hwlib::now_us();
+		for(uint16_t i = 0; i < count;){
+			if(one.queue(0, frame)){
+				i++;
+			}
+			one.service();
+		}
+		one.flush();
+		print_result("1 radio ", one.sent(), count, 0, hwlib::now_us() - start, 32);
+
+		shared_bus_scheduler<2> two({&module01, &module02}, true);
+		start = hwlib::now_us();
+		uint16_t queued_01 = 0;
+		uint16_t queued_02 = 0;
+		while(queued_01 < count || queued_02 < count){
+			if(queued_01 < count && two.queue(0, frame)){
+				queued_01++;
+			}
+			if(queued_02 < count && two.queue(1, frame)){
+				queued_02++;
+			}
+			two.service();
+		}
+		two.flush();
+		print_result("2 radios", two.sent(), 2 * count, 0, hwlib::now_us() - start, 32);
+		two.print_statistics();
+	}
+
+	/**
+	* \brief
+	* Benchmark the payload codecs
+	* \details
+	* module01 sends DHT22 like readings (temperature in tenths of degrees, humidity in tenths of percent and a counter)
+	* to module02: one raw reading per frame, bit-packed frames and delta encoded frames.
+	* The rate is the amount of readings per second that arrived at module02.
+	* @param count	The amount of readings for each codec
+	*/
+	void bench_codec(const uint16_t & count = 300){
+		hwlib::cout << "\nBenchmarking payload codecs\n";
+		setup();
+		module01.set_transmit_address({0xFF,0xAB,0xAB,0xAB,0xAB});
+		module02.set_transmit_address({0xFF,0xAB,0xAB,0xAB,0xAB});
+		module02.start_listening();
+		module01.stop_listening();
+		using packer = bit_packer<codec_field<10, -400>, codec_field<10>, codec_field<8>>;
+		delta_encoder<3> encoder(1);
+		delta_decoder<3> decoder;
+		std::array<delta_decoder<3>::reading, 32> readings;
+		std::array<uint8_t, 32> frame = {0};
+		std::array<uint8_t, 32> recieved;
+		uint8_t node;
+		uint32_t frames[3] = {0};
+		uint32_t delivered[3] = {0};
+		uint64_t duration[3];
+
+		for(uint8_t codec = 0; codec < 3; codec++){
+			uint64_t start = hwlib::now_us();
+			uint8_t packed = 0;
+			frame = {0};
+			for(uint16_t i = 0; i <= count; i++){
+				// Slowly changing readings, a last empty round flushes the frame
+				std::array<int32_t, 3> reading = {215 + (i / 16) % 4, 550 + (i / 8) % 8, i & 0xFF};
+				bool flush = i == count;
+				if(codec == 0 && !flush){
+					frame[0] = reading[0] / 10;
+					frame[1] = reading[1] / 10;
+					frame[2] = reading[2];
+					module01.write_payload(frame, 3);
+					module01.wait_for_transmission();
+					frames[codec]++;
+				}else if(codec == 1 && (flush || !packer::add(frame, packed, reading))){
+					module01.write_payload(frame, packer::frame_size(packed));
+					module01.wait_for_transmission();
+					frames[codec]++;
+					frame = {0};
+					packed = 0;
+					if(!flush){
+						packer::add(frame, packed, reading);
+					}
+				}else if(codec == 2 && (flush || !encoder.add(reading))){
+					encoder.write(module01);
+					frames[codec]++;
+					if(!flush){
+						encoder.add(reading);
+					}
+				}
+				while(module02.data_available()){
+					module02.read(recieved);
+					if(codec == 0){
+						delivered[codec]++;
+					}else if(codec == 1){
+						delivered[codec] += packer::count(recieved);
+					}else{
+						delivered[codec] += decoder.decode(recieved, node, readings);
+					}
+				}
+			}
+			duration[codec] = hwlib::now_us() - start;
+		}
+		const char * names[3] = {"raw   ", "packed", "delta "};
+		for(uint8_t codec = 0; codec < 3; codec++){
+			hwlib::cout << names[codec] << "\t frames=" << hwlib::dec << frames[codec]
+						<< " readings=" << delivered[codec] << "/" << count
+						<< " rate=" << (uint32_t)(uint64_t(delivered[codec]) * 1000000 / duration[codec]) << " readings/s\n";
+		}
+		hwlib::cout << "Delta frames lost=" << decoder.lost() << '\n';
+	}
+
+	/**
+	* \brief
+	* Benchmark the batching sender
+	* \details
+	* module01 sends 3 byte records to module02, first one record per frame and then batched.
+	* The air time is the time module01 spent in TX mode, the energy is estimated with a power_monitor.
+	* @param count	The amount of records for each measurement
+	*/
+	void bench_batching(const uint16_t & count = 120){
+		hwlib::cout << "\nBenchmarking batching sender\n";
+		setup();
+		module01.set_transmit_address({0xFF,0xAB,0xAB,0xAB,0xAB});
+		module02.set_transmit_address({0xFF,0xAB,0xAB,0xAB,0xAB});
+		module02.start_listening();
+		module01.stop_listening();
+		module01.set_power_monitor(monitor);
+		std::array<uint8_t, 3> record = {21, 55, 0};
+		std::array<uint8_t, 32> frame;
+
+		for(uint8_t batched = 0; batched < 2; batched++){
+			batch_sender sender(module01);
+			uint32_t delivered = 0;
+			uint32_t frames = 0;
+			monitor.reset();
+			uint64_t start = hwlib::now_us();
+			for(uint16_t i = 0; i < count; i++){
+				record[2] = i;
+				if(batched){
+					sender.add(0, record);
+				}else{
+					module01.write(record);
+					module01.wait_for_transmission();
+				}
+				while(module02.data_available()){
+					module02.read(frame);
+					frames++;
+					if(batched){
+						batch_reader reader(frame);
+						while(reader.next()){
+							delivered++;
+						}
+					}else{
+						delivered++;
+					}
+				}
+			}
+			sender.flush();
+			while(module02.data_available()){
+				module02.read(frame);
+				frames++;
+				if(batched){
+					batch_reader reader(frame);
+					while(reader.next()){
+						delivered++;
+					}
+				}else{
+					delivered++;
+				}
+			}
+			uint64_t duration = hwlib::now_us() - start;
+			hwlib::cout << (batched ? "batched" : "single ") << "\t records=" << hwlib::dec << delivered << "/" << count
+						<< " frames=" << frames
+						<< " rate=" << (uint32_t)(uint64_t(delivered) * 1000000 / duration) << " records/s"
+						<< " air=" << (uint32_t)(monitor.time_in(state_tx) / count) << "us/record"
+						<< " energy=" << (uint32_t)(monitor.energy_uj() * 1000 / count) << "nJ/record\n";
+		}
+	}
+
+	/**
+	* \brief
+	* Benchmark the secured frames
+	* \details
+	* First the cipher is checked against the Speck64/128 test vector and the time to seal and open a 16 byte payload
+	* is measured. Then module01 sends 16 byte payloads to module02, in plain and secured.
+	* @param count	The amount of frames for each measurement
+	*/
+	void bench_secure(const uint16_t & count = 200){
+		hwlib::cout << "\nBenchmarking secured frames\n";
+		const std::array<uint32_t, 4> key = {0x03020100, 0x0b0a0908, 0x13121110, 0x1b1a1918};
+		speck64 cipher(key);
+		uint32_t x = 0x3b726574;
+		uint32_t y = 0x7475432d;
+		cipher.encrypt(x, y);
+		hwlib::cout << "Speck64/128 test vector " << ((x == 0x8c6fa548 && y == 0x454e028b) ? "passed" : "failed") << '\n';
+
+		secure_sender sender(1, key);
+		secure_reciever<1> reciever;
+		reciever.add_node(1, key);
+		std::array<uint8_t, 16> payload = {0};
+		std::array<uint8_t, 32> frame = {0};
+		uint8_t node;
+		uint64_t start = hwlib::now_us();
+		for(uint16_t i = 0; i < count; i++){
+			payload[0] = i;
+			sender.seal(payload, frame);
+		}
+		uint32_t seal_us = (hwlib::now_us() - start) / count;
+		start = hwlib::now_us();
+		for(uint16_t i = 0; i < count; i++){
+			reciever.open(frame, node, payload);
+		}
+		uint32_t open_us = (hwlib::now_us() - start) / count;
+		hwlib::cout << "seal=" << hwlib::dec << seal_us << "us open=" << open_us << "us overhead="
+					<< secure_overhead << " bytes\n";
+
+		setup();
+		module01.set_transmit_address({0xFF,0xAB,0xAB,0xAB,0xAB});
+		module02.set_transmit_address({0xFF,0xAB,0xAB,0xAB,0xAB});
+		module02.start_listening();
+		module01.stop_listening();
+		for(uint8_t secured = 0; secured < 2; secured++){
+			uint32_t delivered = 0;
+			start = hwlib::now_us();
+			for(uint16_t i = 0; i < count; i++){
+				payload[0] = i;
+				if(secured){
+					sender.write(module01, payload);
+				}else{
+					module01.write(payload);
+					module01.wait_for_transmission();
+				}
+				while(module02.data_available()){
+					module02.read(frame);
+					if(!secured || reciever.open(frame, node, payload)){
+						delivered++;
+					}
+				}
+			}
+			print_result(secured ? "secured" : "plain  ", delivered, count, 0, hwlib::now_us() - start, payload.size());
+		}
+		reciever.print_statistics();
+	}
+
+	/**
+	* \brief
+	* Benchmark the image transfer
+	* \details
+	* module01 sends a generated image to module02 at every data rate, module02 checks every byte it recieves.
+	* Both are polled from the same loop.
+	* @param size	The size of the image in bytes
+	*/
+	void bench_ota(const uint32_t & size = 65536){
+		hwlib::cout << "\nBenchmarking image transfer\n";
+		struct pattern_source : ota_source{
+			uint32_t image_size;
+			pattern_source(const uint32_t & image_size): image_size(image_size){}
+			uint32_t size(void) override {
+				return image_size;
+			}
+			void read(const uint32_t & offset, uint8_t * data, const uint8_t & length) override {
+				for(uint8_t i = 0; i < length; i++){
+					data[i] = uint8_t((offset + i) * 7 + ((offset + i) >> 8));
+				}
+			}
+		};
+		struct pattern_sink : ota_sink{
+			uint32_t errors = 0;
+			void write(const uint32_t & offset, const uint8_t * data, const uint8_t & length) override {
+				for(uint8_t i = 0; i < length; i++){
+					if(data[i] != uint8_t((offset + i) * 7 + ((offset + i) >> 8))){
+						errors++;
+					}
+				}
+			}
+		};
+		const uint8_t rates[3] = {rf24_250kbps, rf24_1mbps, rf24_2mbps};
+		const char * names[3] = {"250kbps", "1mbps  ", "2mbps  "};
+		for(uint8_t i = 0; i < 3; i++){
+			setup();
+			module01.set_data_rate(rates[i]);
+			module02.set_data_rate(rates[i]);
+			module01.set_transmit_address({0xFF,0xAB,0xAB,0xAB,0xAB});
+			module02.set_transmit_address({0xFF,0xAB,0xAB,0xAB,0xAB});
+			module02.start_listening();
+			module01.stop_listening();
+			pattern_source source(size);
+			pattern_sink sink;
+			ota_sender sender(module01, source);
+			ota_reciever reciever(module02, sink);
+			sender.begin();
+			while(sender.poll()){
+				reciever.poll();
+			}
+			hwlib::cout << names[i] << "\t " << (sender.get_state() == ota_complete ? "complete" : "failed")
+						<< " errors=" << hwlib::dec << sink.errors << ' ';
+			sender.print_statistics();
+		}
+	}
+
+	/**
+	* \brief
+	* Benchmark channel switching
+	* \details
+	* module02 listens and hops to a new channel before every frame, module01 follows it. The latency is the time
+	* retune() takes on the listening radio, it is compared to stop_listening(), set_channel() and start_listening().
+	* @param count	The amount of channel switches
+	*/
+	void bench_retune(const uint16_t & count = 100){
+		hwlib::cout << "\nBenchmarking channel switching\n";
+		setup();
+		module01.set_transmit_address({0xFF,0xAB,0xAB,0xAB,0xAB});
+		module02.set_transmit_address({0xFF,0xAB,0xAB,0xAB,0xAB});
+		module02.start_listening();
+		module01.stop_listening();
+		std::array<uint8_t, 4> frame = {0};
+		uint32_t delivered = 0;
+		uint64_t latency = 0;
+		uint64_t start = hwlib::now_us();
+		for(uint16_t i = 0; i < count; i++){
+			uint8_t channel = 2 + (i * 37) % 120;
+			uint64_t before = hwlib::now_us();
+			module02.retune(channel);
+			latency += hwlib::now_us() - before;
+			module01.retune(channel);
+			frame[0] = channel;
+			module01.write(frame);
+			if(module01.wait_for_transmission() && module02.data_available()){
+				module02.read(frame);
+				delivered++;
+			}
+		}
+		print_result("retune ", delivered, count, latency, hwlib::now_us() - start, frame.size());
+
+		const uint8_t slow_count = 3;
+		delivered = 0;
+		latency = 0;
+		start = hwlib::now_us();
+		for(uint8_t i = 0; i < slow_count; i++){
+			uint8_t channel = 2 + (i * 37) % 120;
+			uint64_t before = hwlib::now_us();
+			module02.stop_listening();
+			module02.set_channel(channel);
+			module02.start_listening();
+			latency += hwlib::now_us() - before;
+			module01.retune(channel);
+			module01.write(frame);
+			if(module01.wait_for_transmission() && module02.data_available()){
+				module02.read(frame);
+				delivered++;
+			}
+		}
+		print_result("restart", delivered, slow_count, latency, hwlib::now_us() - start, frame.size());
+	}
+};
+
+#endif // RF_BENCH_HPP
@@ -6,11 +6,27 @@
 #ifndef RF_TEST_HPP
 #define RF_TEST_HPP
 #include "rf24.hpp"
+#include "rf24_static.hpp"
 #include "hwlib.hpp"
 /**
  * @file rf_test.hpp
  */
 
+/**
+ * \brief
+ * Result of a packet error rate measurement
+ */
+struct per_result{
+	uint32_t sent = 0;
+	uint32_t recieved = 0;
+	uint32_t lost = 0;
+	uint32_t duplicates = 0;
+	uint32_t out_of_order = 0;
+	uint32_t rpd_hits = 0;
+	uint32_t per_ppm = 0;
+	uint32_t throughput = 0;
+};
+
 /**
  * \brief
  * RF24 test class
@@ -20,6 +36,33 @@ class rf_test
 private:
 	rf24 & module01;
 	rf24 & module02;
+	
+	/**
+	* \brief
+	* Fill a frame with the PRBS9 sequence (x^9 + x^5 + 1)
+	* \details
+	* The first two bytes are left for the sequence number, every frame gets the same pattern.
+	*/
+	void fill_prbs9(std::array<uint8_t, 32> & frame){
+		uint16_t lfsr = 0x1FF;
+		for(uint8_t i = 2; i < frame.size(); i++){
+			uint8_t byte = 0;
+			for(uint8_t bit = 0; bit < 8; bit++){
+				uint8_t feedback = ((lfsr >> 8) ^ (lfsr >> 4)) & 1;
+				lfsr = ((lfsr << 1) | feedback) & 0x1FF;
+				byte = (byte << 1) | feedback;
+			}
+			frame[i] = byte;
+		}
+	}
+	
+	uint8_t count_bits(uint8_t byte){
+		uint8_t bits = 0;
+		for(; byte; byte &= byte - 1){
+			bits++;
+		}
+		return bits;
+	}
 public:
 	/**
 	* \brief
@@ -213,6 +256,71 @@ public:
 	}
 	/**
 	* \brief
+	* Test if both radio's use the same link configuration
+	* \details
+	* This function compares the settings that need to be equal on the transmitting and the recieving side,
+	* the test outcome will be printed to the terminal.
+	*/
+	void test_link_configuration(void){
+		hwlib::cout << "\nTesting link configuration of both modules\n";
+		if(module01.get_channel() == module02.get_channel()){
+			hwlib::cout << "[OK]	Channel is equal\n";
+		}else{
+			hwlib::cout << "[FAIL]	Channel differs\n";
+		}
+		if((module01.read_register(R_REGISTER + RF_SETUP) & ((1<<RF_DR_LOW) | (1<<RF_DR_HIGH))) ==
+		   (module02.read_register(R_REGISTER + RF_SETUP) & ((1<<RF_DR_LOW) | (1<<RF_DR_HIGH)))){
+			hwlib::cout << "[OK]	Data rate is equal\n";
+		}else{
+			hwlib::cout << "[FAIL]	Data rate differs\n";
+		}
+		if(module01.get_crc_length() == module02.get_crc_length()){
+			hwlib::cout << "[OK]	CRC length is equal\n";
+		}else{
+			hwlib::cout << "[FAIL]	CRC length differs\n";
+		}
+		if(module01.get_address_width() == module02.get_address_width()){
+			hwlib::cout << "[OK]	Address width is equal\n";
+		}else{
+			hwlib::cout << "[FAIL]	Address width differs\n";
+		}
+		if((module01.read_register(R_REGISTER + FEATURE) & (1<<EN_DPL)) == (module02.read_register(R_REGISTER + FEATURE) & (1<<EN_DPL))){
+			hwlib::cout << "[OK]	Dynamic payload setting is equal\n";
+		}else{
+			hwlib::cout << "[FAIL]	Dynamic payload setting differs\n";
+		}
+	}
+	/**
+	* \brief
+	* Test the register image of a compile-time configuration
+	* \details
+	* This function writes the configuration with rf24_static::begin() and reads every register back with the first module,
+	* so the bus and pins must be those of the first module. The first module is configured with begin() afterwards.
+	* The test outcome will be printed to the terminal.
+	* @returns True if every register holds the value of the configuration
+	*/
+	template<typename config>
+	bool test_static_configuration(hwlib::spi_bus & bus, hwlib::pin_out & ce, hwlib::pin_out & csn){
+		hwlib::cout << "\nTesting the register image of a compile-time configuration\n";
+		rf24_static<config> radio(bus, ce, csn);
+		radio.begin();
+		bool passed = true;
+		for(const auto & reg : config::register_image){
+			uint8_t value = module01.read_register(R_REGISTER + reg[0]);
+			if(value != reg[1]){
+				hwlib::cout << "[FAIL]	Register 0x" << hwlib::hex << reg[0] << " is 0x" << value
+							<< " instead of 0x" << reg[1] << '\n';
+				passed = false;
+			}
+		}
+		if(passed){
+			hwlib::cout << "[OK]	All registers hold the configuration\n";
+		}
+		module01.begin();
+		return passed;
+	}
+	/**
+	* \brief
 	* Test communication between two radio's
 	* \details
 	* This test writes an constructor with two values from one module to the other.
@@ -276,7 +384,12 @@ public:
 			
 			// Print out recieved data
 			hwlib::cout << "Recieved temperature: " << hwlib::dec << recv.temperature << '\n';
-			hwlib::cout << "Recieved humidity: " << hwlib::dec << recv.humidity << "\n\n";
+			hwlib::cout << "Recieved humidity: " << hwlib::dec << recv.humidity << '\n';
+			if(recv.temperature == payload.temperature && recv.humidity == payload.humidity){
+				hwlib::cout << "[OK]	Recieved message equals send message\n\n";
+			}else{
+				hwlib::cout << "[FAIL]	Recieved message differs from send message\n\n";
+			}
 			
 			// Set temp and humidity one value higher for the next loop
 			payload.temperature++;
@@ -286,6 +399,271 @@ public:
 		}
 		hwlib::cout << "Two-radio communication test finished!\n";
 }
+	/**
+	* \brief
+	* Test the constant carrier of module #1
+	* \details
+	* Module #1 transmits an unmodulated carrier, module #2 checks with the recieved power detector that the carrier
+	* is present on the channel and absent on a channel far away. The carrier stays on for the given time so the
+	* frequency and output power can be measured with a spectrum analyzer.
+	* @param channel		The channel of the carrier
+	* @param level			The PA level of the carrier
+	* @param duration_ms	The time the carrier stays on
+	* @returns True if the test passed
+	*/
+	bool test_carrier(const uint8_t & channel = 40, const uint8_t & level = pwr_max, const uint32_t & duration_ms = 0){
+		hwlib::cout << "\nTesting constant carrier on channel " << hwlib::dec << channel << " at power level " << level << '\n';
+		bool passed = true;
+		rf24_snapshot saved02 = module02.snapshot();
+		module02.power_up();
+		rf24_snapshot saved01 = module01.start_carrier(channel, level);
+		uint8_t setup = module01.read_register(RF_SETUP);
+		if((setup & ((1<<CONT_WAVE) | (1<<PLL_LOCK))) == ((1<<CONT_WAVE) | (1<<PLL_LOCK))){
+			hwlib::cout << "[OK]	Carrier mode set on module #1\n";
+		}else{
+			hwlib::cout << "[FAIL]	Carrier mode not set on module #1\n";
+			passed = false;
+		}
+		module02.set_channel(channel);
+		if(module02.carrier_detected()){
+			hwlib::cout << "[OK]	Carrier detected by module #2\n";
+		}else{
+			hwlib::cout << "[FAIL]	No carrier detected by module #2\n";
+			passed = false;
+		}
+		// A channel 60MHz away should be clear of the carrier
+		module02.set_channel(channel < 63 ? channel + 60 : channel - 60);
+		if(!module02.carrier_detected()){
+			hwlib::cout << "[OK]	Carrier confined to its channel\n";
+		}else{
+			hwlib::cout << "[FAIL]	Carrier detected outside its channel\n";
+			passed = false;
+		}
+		hwlib::wait_ms(duration_ms);
+		module01.restore(saved01);
+		module02.restore(saved02);
+		return passed;
+	}
+	/**
+	* \brief
+	* Measure the packet and bit error rate of a continuous packet stream
+	* \details
+	* Module #1 sends sequence numbered PRBS9 frames as fast as possible over a raw link without acknowledge and CRC,
+	* module #2 recieves them. Packets that never arrived count for the packet error rate, flipped payload bits of
+	* the recieved packets for the bit error rate. Both rates are printed in ppm with the verdict.
+	* @param count			The amount of packets to send
+	* @param channel		The channel of the link
+	* @param rate			The data rate of the link
+	* @param level			The PA level of module #1
+	* @param max_per_ppm	The highest packet error rate that passes
+	* @param max_ber_ppm	The highest bit error rate that passes
+	* @returns True if the test passed
+	*/
+	bool test_prbs_stream(const uint16_t & count = 1000, const uint8_t & channel = 40, const uint8_t & rate = rf24_2mbps,
+	                      const uint8_t & level = pwr_low, const uint32_t & max_per_ppm = 10000, const uint32_t & max_ber_ppm = 1000){
+		hwlib::cout << "\nTesting PRBS9 packet stream, " << hwlib::dec << count << " packets on channel " << channel << '\n';
+		const std::array<uint8_t, 5> test_address = {0xC3, 0x5A, 0x96, 0x3C, 0xA5};
+		const uint8_t payload_bits = 30 * 8;
+		std::array<uint8_t, 32> frame;
+		std::array<uint8_t, 32> recieved_frame;
+		fill_prbs9(frame);
+		
+		rf24_snapshot saved01 = module01.snapshot();
+		rf24_snapshot saved02 = module02.snapshot();
+		module01.set_transmit_address(test_address);
+		module02.set_transmit_address(test_address);
+		module01.set_data_rate(rate);
+		module02.set_data_rate(rate);
+		module01.set_power_level(level);
+		module01.start_raw_link(channel, false);
+		module02.start_raw_link(channel, true);
+		// Give the reciever the RX settling time
+		hwlib::wait_us(130);
+		
+		uint32_t recieved = 0;
+		uint32_t bit_errors = 0;
+		uint32_t tx_errors = 0;
+		uint64_t start = hwlib::now_us();
+		for(uint16_t i = 0; i <= count; i++){
+			if(i < count){
+				frame[0] = uint8_t(i);
+				frame[1] = uint8_t(i >> 8);
+				module01.write_payload(frame, 32);
+				if(!module01.wait_for_transmission(10000)){
+					tx_errors++;
+				}
+			}
+			while(module02.data_available()){
+				module02.read(recieved_frame);
+				uint16_t sequence = recieved_frame[0] | (recieved_frame[1] << 8);
+				// A frame with a corrupted sequence number is counted, but can not be matched to a sent frame
+				if(sequence < count){
+					recieved++;
+				}
+				for(uint8_t byte = 2; byte < 32; byte++){
+					bit_errors += count_bits(frame[byte] ^ recieved_frame[byte]);
+				}
+			}
+		}
+		uint64_t duration = hwlib::now_us() - start;
+		module01.restore(saved01);
+		module02.restore(saved02);
+		
+		recieved = std::min(recieved, uint32_t(count));
+		uint32_t per_ppm = count ? uint32_t(uint64_t(count - recieved) * 1000000 / count) : 0;
+		uint32_t ber_ppm = recieved ? uint32_t(uint64_t(bit_errors) * 1000000 / (uint64_t(recieved) * payload_bits)) : 1000000;
+		hwlib::cout << "Sent=" << count << " recieved=" << recieved << " tx_errors=" << tx_errors
+					<< " bit_errors=" << bit_errors << '\n';
+		hwlib::cout << "PER=" << per_ppm << "ppm BER=" << ber_ppm << "ppm rate="
+					<< (uint32_t)(uint64_t(count) * 1000000 / duration) << " packets/s\n";
+		bool passed = tx_errors == 0 && per_ppm <= max_per_ppm && ber_ppm <= max_ber_ppm;
+		if(passed){
+			hwlib::cout << "[OK]	PRBS stream within limits\n";
+		}else{
+			hwlib::cout << "[FAIL]	PRBS stream outside limits\n";
+		}
+		return passed;
+	}
+	/**
+	* \brief
+	* Production test of a board
+	* \details
+	* Runs the carrier test on the lowest, middle and highest channel and the PRBS stream at every data rate,
+	* then prints one verdict for the line tester.
+	* @returns True if all tests passed
+	*/
+	bool test_production(void){
+		hwlib::cout << "\nProduction test\n";
+		bool passed = true;
+		const std::array<uint8_t, 3> channels = {0, 62, 125};
+		for(const uint8_t & channel : channels){
+			passed &= test_carrier(channel, pwr_max);
+		}
+		const std::array<uint8_t, 3> rates = {rf24_250kbps, rf24_1mbps, rf24_2mbps};
+		for(const uint8_t & rate : rates){
+			passed &= test_prbs_stream(1000, 40, rate);
+		}
+		hwlib::cout << (passed ? "\n[PASS]	Board passed the production test\n" : "\n[FAIL]	Board failed the production test\n");
+		return passed;
+	}
+	/**
+	* \brief
+	* Measure the packet error rate of the link from module #1 to module #2
+	* \details
+	* Module #1 sends sequence numbered frames, module #2 keeps track of which frames arrived.
+	* Frames that never arrived are lost, frames that arrived again are duplicates and frames with a lower
+	* sequence number than an earlier frame are out of order. After every recieved frame the recieved power
+	* detector is read, its hit ratio shows if the link has margin above -64dBm.
+	* The configuration of both radios is restored afterwards.
+	* @param count			The amount of frames to send, at most 4096
+	* @param rate			The data rate of the link
+	* @param level			The PA level of module #1
+	* @param payload_size	The size of the frames, 2 up to and including 32 bytes
+	* @param interval_us	The time between the start of two frames, 0 sends as fast as possible
+	* @param retries		The amount of retransmissions, 0 sends every frame once
+	* @returns The measured figures
+	*/
+	per_result measure_per(uint16_t count, const uint8_t & rate, const uint8_t & level, uint8_t payload_size = 32,
+	                       const uint32_t & interval_us = 0, const uint8_t & retries = 0){
+		per_result result;
+		const uint16_t max_count = 4096;
+		count = std::min(count, max_count);
+		payload_size = std::max(uint8_t(2), std::min(payload_size, uint8_t(32)));
+		std::array<uint8_t, max_count / 8> seen = {0};
+		std::array<uint8_t, 32> frame = {0};
+		std::array<uint8_t, 32> recieved_frame;
+		
+		rf24_snapshot saved01 = module01.snapshot();
+		rf24_snapshot saved02 = module02.snapshot();
+		module01.set_transmit_address({0xA5, 0x3C, 0x96, 0x5A, 0xC3});
+		module02.set_transmit_address({0xA5, 0x3C, 0x96, 0x5A, 0xC3});
+		module01.set_data_rate(rate);
+		module02.set_data_rate(rate);
+		module01.set_power_level(level);
+		module01.set_retransmission(1, retries);
+		module01.enter_tx_mode();
+		module02.enter_rx_mode();
+		
+		int32_t highest = -1;
+		uint64_t start = hwlib::now_us();
+		uint64_t next = start;
+		for(uint16_t i = 0; i <= count; i++){
+			if(i < count){
+				while(hwlib::now_us() < next){}
+				next += interval_us;
+				frame[0] = uint8_t(i);
+				frame[1] = uint8_t(i >> 8);
+				module01.write_payload(frame, payload_size);
+				module01.wait_for_transmission(20000);
+				result.sent++;
+			}
+			while(module02.data_available()){
+				module02.read(recieved_frame);
+				uint16_t sequence = recieved_frame[0] | (recieved_frame[1] << 8);
+				if(sequence >= count){
+					continue;
+				}
+				if(module02.read_register(RPD) & 0x01){
+					result.rpd_hits++;
+				}
+				if(seen[sequence / 8] & (1 << (sequence % 8))){
+					result.duplicates++;
+					continue;
+				}
+				seen[sequence / 8] |= (1 << (sequence % 8));
+				result.recieved++;
+				if(int32_t(sequence) < highest){
+					result.out_of_order++;
+				}
+				highest = std::max(highest, int32_t(sequence));
+			}
+		}
+		uint64_t duration = hwlib::now_us() - start;
+		module01.restore(saved01);
+		module02.restore(saved02);
+		
+		result.lost = result.sent - result.recieved;
+		result.per_ppm = result.sent ? uint32_t(uint64_t(result.lost) * 1000000 / result.sent) : 0;
+		result.throughput = duration ? uint32_t(uint64_t(result.recieved) * payload_size * 1000000 / duration) : 0;
+		return result;
+	}
+	/**
+	* \brief
+	* Print a table of packet error rate measurements
+	* \details
+	* Runs measure_per() for every data rate and PA level and prints one row per configuration,
+	* the configuration with the highest throughput is printed at the end.
+	* @param count			The amount of frames to send per configuration
+	* @param payload_size	The size of the frames
+	* @param interval_us	The time between the start of two frames, 0 sends as fast as possible
+	*/
+	void test_per_table(const uint16_t & count = 1000, const uint8_t & payload_size = 32, const uint32_t & interval_us = 0){
+		std::array<const char *, 3> rate_str = {"rf24_1mbps", "rf24_2mbps", "rf24_250kbps"};
+		std::array<const char *, 4> pwr_str = {"pwr_min", "pwr_low", "pwr_high", "pwr_max"};
+		hwlib::cout << "\nPacket error rate, " << hwlib::dec << count << " frames of " << payload_size << " bytes\n";
+		hwlib::cout << "rate\t\tlevel\t\trecieved\tlost\tdup\tooo\trpd%\tPER ppm\tB/s\n";
+		uint32_t best_throughput = 0;
+		uint8_t best_rate = 0;
+		uint8_t best_level = 0;
+		const std::array<uint8_t, 3> rates = {rf24_250kbps, rf24_1mbps, rf24_2mbps};
+		for(const uint8_t & rate : rates){
+			for(uint8_t level = pwr_min; level <= pwr_max; level++){
+				per_result result = measure_per(count, rate, level, payload_size, interval_us);
+				hwlib::cout << rate_str[rate] << '\t' << pwr_str[level] << "\t\t"
+							<< result.recieved << "/" << result.sent << '\t'
+							<< result.lost << '\t' << result.duplicates << '\t' << result.out_of_order << '\t'
+							<< (result.recieved ? result.rpd_hits * 100 / (result.recieved + result.duplicates) : 0) << '\t'
+							<< result.per_ppm << '\t' << result.throughput << '\n';
+				if(result.throughput > best_throughput){
+					best_throughput = result.throughput;
+					best_rate = rate;
+					best_level = level;
+				}
+			}
+		}
+		hwlib::cout << "Best throughput: " << rate_str[best_rate] << " " << pwr_str[best_level]
+					<< " " << best_throughput << " B/s\n";
+	}
 };
 
 #endif // RF_TEST_HPP
@@ -0,0 +1,425 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef SECURE_HPP
+#define SECURE_HPP
+#include "rf24.hpp"
+#include "nrf24l01.hpp"
+#include "hwlib.hpp"
+/**
+ * @file secure.hpp
+ */
+
+/// Bytes added to every secured frame: node, 32 bit counter and a 32 bit MAC
+const uint8_t secure_overhead = 9;
+/// The maximum size of a secured payload
+const uint8_t secure_payload_size = 32 - secure_overhead;
+
+/**
+ * \brief
+ * Speck64/128 block cipher
+ * \details
+ * Speck only uses additions, rotations and xors on 32 bit words, so it needs no tables and the time it takes
+ * does not depend on the key or the data. Only encryption is needed for CTR mode and CBC-MAC.
+ * The key is given as {k0, k1, k2, k3}, a block as the words x and y.
+ * @code
+ * speck64 cipher({0x03020100, 0x0b0a0908, 0x13121110, 0x1b1a1918});
+ * uint32_t x = 0x3b726574, y = 0x7475432d;
+ * cipher.encrypt(x, y);
+ * // x is now 0x8c6fa548 and y 0x454e028b
+ * @endcode
+ */
+class speck64
+{
+private:
+	static const uint8_t rounds = 27;
+	std::array<uint32_t, rounds> round_keys;
+
+	static uint32_t rotate_right(const uint32_t & value, const uint8_t & bits){
+		return (value >> bits) | (value << (32 - bits));
+	}
+
+	static uint32_t rotate_left(const uint32_t & value, const uint8_t & bits){
+		return (value << bits) | (value >> (32 - bits));
+	}
+
+public:
+	/**
+	* \brief
+	* Create the cipher with an all zero key schedule, call set_key() before use
+	*/
+	speck64(void):
+		round_keys({0})
+	{}
+
+	/**
+	* \brief
+	* Create the cipher and expand the key
+	* @param key	The 128 bit key as four words
+	*/
+	speck64(const std::array<uint32_t, 4> & key){
+		set_key(key);
+	}
+
+	/**
+	* \brief
+	* Expand the key
+	* @param key	The 128 bit key as four words
+	*/
+	void set_key(const std::array<uint32_t, 4> & key){
+		std::array<uint32_t, 3> l = {key[1], key[2], key[3]};
+		round_keys[0] = key[0];
+		for(uint8_t i = 0; i < rounds - 1; i++){
+			uint32_t next = (round_keys[i] + rotate_right(l[i % 3], 8)) ^ i;
+			l[i % 3] = next;
+			round_keys[i + 1] = rotate_left(round_keys[i], 3) ^ next;
+		}
+	}
+
+	/**
+	* \brief
+	* Encrypt one block in place
+	*/
+	void encrypt(uint32_t & x, uint32_t & y) const {
+		for(uint8_t i = 0; i < rounds; i++){
+			x = (rotate_right(x, 8) + y) ^ round_keys[i];
+			y = rotate_left(y, 3) ^ x;
+		}
+	}
+};
+
+/**
+ * \brief
+ * Authenticated encryption of frames, in the style of AES-CCM
+ * \details
+ * The payload is encrypted with Speck64/128 in counter mode and authenticated with a CBC-MAC over the node,
+ * the counter, the length and the payload. The MAC is truncated to 32 bits.
+ * A secured frame is the node, the counter (LSB first), the encrypted payload and the encrypted MAC.
+ * The counter is the nonce, it increases with every frame and must never repeat for the same key:
+ * save it in non-volatile memory or give every boot a new key.
+ */
+class secure_codec
+{
+private:
+	speck64 cipher;
+
+	static uint32_t load(const uint8_t * bytes, const uint8_t & available){
+		uint32_t word = 0;
+		for(uint8_t i = 0; i < 4 && i < available; i++){
+			word |= uint32_t(bytes[i]) << (8 * i);
+		}
+		return word;
+	}
+
+	uint32_t keystream(const uint8_t & node, const uint32_t & counter, const uint8_t & block, uint32_t & y) const {
+		uint32_t x = counter;
+		y = (uint32_t(node) << 24) | block;
+		cipher.encrypt(x, y);
+		return x;
+	}
+
+	uint32_t mac(const uint8_t & node, const uint32_t & counter, const uint8_t * data, const uint8_t & length) const {
+		uint32_t x = counter;
+		uint32_t y = (uint32_t(node) << 24) | 0x010000 | length;
+		cipher.encrypt(x, y);
+		for(uint8_t i = 0; i < length; i += 8){
+			x ^= load(data + i, length - i);
+			y ^= (length - i > 4) ? load(data + i + 4, length - i - 4) : 0;
+			cipher.encrypt(x, y);
+		}
+		return x;
+	}
+
+	void crypt(const uint8_t & node, const uint32_t & counter, const uint8_t * in, uint8_t * out, const uint8_t & length) const {
+		for(uint8_t i = 0; i < length; i += 8){
+			uint32_t y;
+			uint32_t x = keystream(node, counter, 1 + i / 8, y);
+			for(uint8_t j = 0; j < 8 && i + j < length; j++){
+				uint8_t key_byte = (j < 4) ? uint8_t(x >> (8 * j)) : uint8_t(y >> (8 * (j - 4)));
+				out[i + j] = in[i + j] ^ key_byte;
+			}
+		}
+	}
+
+public:
+	/**
+	* \brief
+	* The codec constructor, call set_key() before use
+	*/
+	secure_codec(void)
+	{}
+
+	/**
+	* \brief
+	* The codec constructor
+	* @param key	The 128 bit key as four words
+	*/
+	secure_codec(const std::array<uint32_t, 4> & key):
+		cipher(key)
+	{}
+
+	/**
+	* \brief
+	* Change the key
+	*/
+	void set_key(const std::array<uint32_t, 4> & key){
+		cipher.set_key(key);
+	}
+
+	/**
+	* \brief
+	* Encrypt and authenticate data into a frame
+	* @param node		The node sending the frame
+	* @param counter	The nonce of the frame
+	* @param data		The data
+	* @param length		The size of the data, at most secure_payload_size
+	* @param frame		The secured frame
+	* @returns The size of the secured frame, 0 if the data does not fit
+	*/
+	uint8_t seal(const uint8_t & node, const uint32_t & counter, const uint8_t * data, const uint8_t & length,
+	             std::array<uint8_t, 32> & frame) const {
+		if(length > secure_payload_size){
+			return 0;
+		}
+		frame[0] = node;
+		for(uint8_t i = 0; i < 4; i++){
+			frame[1 + i] = uint8_t(counter >> (8 * i));
+		}
+		crypt(node, counter, data, frame.begin() + 5, length);
+		uint32_t y;
+		uint32_t tag = mac(node, counter, data, length) ^ keystream(node, counter, 0, y);
+		for(uint8_t i = 0; i < 4; i++){
+			frame[5 + length + i] = uint8_t(tag >> (8 * i));
+		}
+		return length + secure_overhead;
+	}
+
+	/**
+	* \brief
+	* Check and decrypt a frame
+	* \details
+	* The MAC is compared in constant time, data is only written when the MAC is correct.
+	* @param frame			The secured frame
+	* @param length			The size of the payload in the frame
+	* @param[in] counter	The nonce of the frame
+	* @param[in] data		The decrypted data
+	* @returns True if the MAC is correct, false if the length is larger than secure_payload_size
+	*/
+	bool open(const std::array<uint8_t, 32> & frame, const uint8_t & length, uint32_t & counter, uint8_t * data) const {
+		if(length > secure_payload_size){
+			return 0;
+		}
+		std::array<uint8_t, secure_payload_size> plain;
+		uint8_t node = frame[0];
+		counter = load(frame.begin() + 1, 4);
+		crypt(node, counter, frame.begin() + 5, plain.begin(), length);
+		uint32_t y;
+		uint32_t tag = mac(node, counter, plain.begin(), length) ^ keystream(node, counter, 0, y);
+		uint32_t difference = tag ^ load(frame.begin() + 5 + length, 4);
+		if(difference){
+			return 0;
+		}
+		for(uint8_t i = 0; i < length; i++){
+			data[i] = plain[i];
+		}
+		return 1;
+	}
+};
+
+/**
+ * \brief
+ * Sender of secured frames
+ * @code
+ * secure_sender sender(1, {0x03020100, 0x0b0a0908, 0x13121110, 0x1b1a1918});
+ * radio.stop_listening();
+ * sender.write(radio, data);
+ * @endcode
+ */
+class secure_sender
+{
+private:
+	uint8_t node;
+	secure_codec codec;
+	uint32_t counter;
+
+public:
+	/**
+	* \brief
+	* The secure sender constructor
+	* @param node		The address of this node
+	* @param key		The key of this node
+	* @param counter	The first counter, continue where the previous boot stopped
+	*/
+	secure_sender(const uint8_t & node, const std::array<uint32_t, 4> & key, const uint32_t & counter = 0):
+		node(node),
+		codec(key),
+		counter(counter)
+	{}
+
+	/**
+	* \brief
+	* Secure data into a frame
+	* @returns The size of the secured frame
+	*/
+	template<typename datatype>
+	uint8_t seal(const datatype & d, std::array<uint8_t, 32> & frame){
+		static_assert(sizeof(d) <= secure_payload_size, "Data does not fit in a secured frame");
+		return codec.seal(node, counter++, reinterpret_cast<const uint8_t *>(&d), sizeof(d), frame);
+	}
+
+	/**
+	* \brief
+	* Secure and send data
+	* @returns True if the frame has been send succesfully
+	*/
+	template<typename datatype>
+	bool write(rf24 & radio, const datatype & d){
+		std::array<uint8_t, 32> frame = {0};
+		radio.write_payload(frame, seal(d, frame));
+		return radio.wait_for_transmission();
+	}
+
+	/**
+	* \brief
+	* Get the next counter, save this value before powering off
+	*/
+	uint32_t get_counter(void) const {
+		return counter;
+	}
+};
+
+/**
+ * \brief
+ * Reciever of secured frames from several nodes
+ * \details
+ * Every node has its own key. The highest counter of every node is kept together with a 32 frame window
+ * behind it, a frame with a counter that has been seen before or is older than the window is rejected.
+ * @code
+ * secure_reciever<4> reciever;
+ * reciever.add_node(1, key);
+ * std::array<uint8_t, 32> frame;
+ * radio.read(frame);
+ * uint8_t node;
+ * if(reciever.open(frame, node, data)){
+ * 	hwlib::cout << "Data from node " << node << '\n';
+ * }
+ * @endcode
+ * The data type must be the same as the one given to the sender, otherwise the MAC is not correct.
+ */
+template<size_t nodes = 4>
+class secure_reciever
+{
+private:
+	struct node_keys{
+		uint8_t node = 0;
+		secure_codec codec;
+		bool seen = false;
+		uint32_t highest = 0;
+		uint32_t window = 0;
+	};
+
+	std::array<node_keys, nodes> keys;
+	size_t count = 0;
+	uint32_t accepted = 0;
+	uint32_t bad_mac = 0;
+	uint32_t replayed = 0;
+	uint32_t unknown = 0;
+
+	node_keys * find(const uint8_t & node){
+		for(size_t i = 0; i < count; i++){
+			if(keys[i].node == node){
+				return &keys[i];
+			}
+		}
+		return nullptr;
+	}
+
+	bool is_replay(const node_keys & keys, const uint32_t & counter) const {
+		if(!keys.seen || counter > keys.highest){
+			return 0;
+		}
+		uint32_t age = keys.highest - counter;
+		return age >= 32 || (keys.window & (uint32_t(1) << age));
+	}
+
+	void accept(node_keys & keys, const uint32_t & counter){
+		if(!keys.seen){
+			keys.seen = true;
+			keys.highest = counter;
+			keys.window = 1;
+		}else if(counter > keys.highest){
+			uint32_t shift = counter - keys.highest;
+			keys.window = (shift >= 32) ? 1 : (keys.window << shift) | 1;
+			keys.highest = counter;
+		}else{
+			keys.window |= uint32_t(1) << (keys.highest - counter);
+		}
+	}
+
+public:
+	/**
+	* \brief
+	* Add the key of a node
+	* @returns False if the node is already known or there is no room for another node
+	*/
+	bool add_node(const uint8_t & node, const std::array<uint32_t, 4> & key){
+		if(count >= nodes || find(node) != nullptr){
+			return 0;
+		}
+		keys[count].node = node;
+		keys[count].codec.set_key(key);
+		count++;
+		return 1;
+	}
+
+	/**
+	* \brief
+	* Check, decrypt and accept a recieved frame
+	* @param frame		The recieved frame
+	* @param[in] node	The node that send the frame
+	* @param[in] d		The decrypted data
+	* @returns True if the frame is authentic and not a replay
+	*/
+	template<typename datatype>
+	bool open(const std::array<uint8_t, 32> & frame, uint8_t & node, datatype & d){
+		static_assert(sizeof(d) <= secure_payload_size, "Data does not fit in a secured frame");
+		node = frame[0];
+		node_keys * sender = find(node);
+		if(sender == nullptr){
+			unknown++;
+			return 0;
+		}
+		std::array<uint8_t, sizeof(d)> data;
+		uint32_t counter;
+		if(!sender->codec.open(frame, sizeof(d), counter, data.begin())){
+			bad_mac++;
+			return 0;
+		}
+		if(is_replay(*sender, counter)){
+			replayed++;
+			return 0;
+		}
+		accept(*sender, counter);
+		accepted++;
+		uint8_t * out = reinterpret_cast<uint8_t *>(&d);
+		for(uint8_t i = 0; i < sizeof(d); i++){
+			out[i] = data[i];
+		}
+		return 1;
+	}
+
+	/**
+	* \brief
+	* Print the amount of accepted and rejected frames
+	*/
+	void print_statistics(void) const {
+		hwlib::cout << "Secure accepted=" << hwlib::dec << accepted
+					<< " bad_mac=" << bad_mac
+					<< " replayed=" << replayed
+					<< " unknown=" << unknown << '\n';
+	}
+};
+
+#endif // SECURE_HPP
@@ -0,0 +1,167 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef SHARED_BUS_HPP
+#define SHARED_BUS_HPP
+#include "rf24.hpp"
+#include "nrf24l01.hpp"
+#include "hwlib.hpp"
+/**
+ * @file shared_bus.hpp
+ */
+
+/**
+ * \brief
+ * Transmit scheduler for several radios on one SPI bus
+ * \details
+ * Radios on one bus only need their own CE and CSN pins:
+ * @code
+ * auto spi_bus = hwlib::spi_bus_bit_banged_sclk_mosi_miso(SCK, MOSI, MISO);
+ * rf24 radio(spi_bus, CE, CSN);
+ * rf24 radio_2(spi_bus, CE_2, CSN_2);
+ * shared_bus_scheduler<2> scheduler({&radio, &radio_2});
+ * scheduler.queue(0, data);
+ * scheduler.queue(1, data);
+ * scheduler.flush();
+ * @endcode
+ * Frames are queued per radio. Every call to service() makes one pass over all radios: a radio that has finished
+ * its transmission gets the next frame uploaded, so every radio is on air while the bus serves the others.
+ * Each radio costs one STATUS read per pass while it is busy and one payload upload when it is free.
+ * All bus access goes through service(), so transactions of different radios never interleave.
+ * @note Do not use the radios directly from an interrupt while the scheduler is in use
+ */
+template<size_t count, size_t depth = 4>
+class shared_bus_scheduler
+{
+private:
+	struct radio_queue{
+		std::array<std::array<uint8_t, 32>, depth> frames;
+		size_t head = 0;
+		size_t size = 0;
+		bool busy = false;
+		uint32_t sent = 0;
+		uint32_t failed = 0;
+	};
+
+	std::array<rf24 *, count> radios;
+	std::array<radio_queue, count> queues;
+	bool no_ack;
+	uint32_t passes = 0;
+
+public:
+	/**
+	* \brief
+	* The scheduler constructor
+	* @param radios	Pointers to the radios, all in TX mode
+	* @param no_ack	Send without requesting an acknowledge
+	*/
+	shared_bus_scheduler(const std::array<rf24 *, count> & radios, const bool & no_ack = false):
+		radios(radios),
+		no_ack(no_ack)
+	{}
+
+	/**
+	* \brief
+	* Queue data for a radio
+	* \details
+	* The data is padded to a 32 byte frame.
+	* @returns False if the queue of the radio is full
+	*/
+	template<typename datatype>
+	bool queue(const size_t & index, const datatype & d){
+		static_assert(sizeof(d) <= 32, "Data does not fit in a frame");
+		if(index >= count || queues[index].size >= depth){
+			return 0;
+		}
+		radio_queue & q = queues[index];
+		std::array<uint8_t, 32> & frame = q.frames[(q.head + q.size) % depth];
+		frame = {0};
+		const uint8_t * data = reinterpret_cast<const uint8_t *>(&d);
+		for(uint8_t i = 0; i < sizeof(d); i++){
+			frame[i] = data[i];
+		}
+		q.size++;
+		return 1;
+	}
+
+	/**
+	* \brief
+	* Make one pass over all radios
+	* @returns The amount of frames which are queued or on air
+	*/
+	size_t service(void){
+		size_t pending = 0;
+		passes++;
+		for(size_t i = 0; i < count; i++){
+			radio_queue & q = queues[i];
+			if(q.busy){
+				uint8_t result = radios[i]->check_transmission();
+				if(result == tx_pending){
+					pending += 1 + q.size;
+					continue;
+				}
+				if(result == tx_sent){
+					q.sent++;
+				}else{
+					q.failed++;
+				}
+				q.busy = false;
+			}
+			if(q.size > 0){
+				bool accepted = true;
+				if(no_ack){
+					radios[i]->write_no_ack(q.frames[q.head]);
+				}else{
+					accepted = radios[i]->write(q.frames[q.head]);
+				}
+				q.head = (q.head + 1) % depth;
+				q.size--;
+				if(!accepted){
+					// A full TX FIFO or the MAX_RT flush dropped the frame, no TX_DS or MAX_RT will follow
+					q.failed++;
+					pending += q.size;
+					continue;
+				}
+				q.busy = true;
+				pending += 1 + q.size;
+			}
+		}
+		return pending;
+	}
+
+	/**
+	* \brief
+	* Service the radios until all queued frames have been send
+	*/
+	void flush(void){
+		while(service() > 0){}
+	}
+
+	/**
+	* \brief
+	* Get the amount of frames that have been send
+	*/
+	uint32_t sent(void) const {
+		uint32_t total = 0;
+		for(const auto & q : queues){
+			total += q.sent;
+		}
+		return total;
+	}
+
+	/**
+	* \brief
+	* Print the statistics of every radio
+	*/
+	void print_statistics(void) const {
+		for(size_t i = 0; i < count; i++){
+			hwlib::cout << "Radio " << hwlib::dec << i
+						<< "\tsent=" << queues[i].sent << " failed=" << queues[i].failed << '\n';
+		}
+		hwlib::cout << "Service passes=" << passes << '\n';
+	}
+};
+
+#endif // SHARED_BUS_HPP
@@ -0,0 +1,334 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef SLOTTED_LISTENER_HPP
+#define SLOTTED_LISTENER_HPP
+#include "rf24.hpp"
+#include "hwlib.hpp"
+/**
+ * @file slotted_listener.hpp
+ */
+
+/**
+ * \brief
+ * First byte of a beacon frame
+ * \details
+ * Application frames send to a slotted_listener must not start with this value.
+ */
+const uint8_t beacon_type = 0xBE;
+
+/**
+ * \brief
+ * Maximum amount of slots in a superframe
+ * \details
+ * The slots a slotted_listener listens in are a 32 bit mask.
+ */
+const uint8_t beacon_max_slots = 32;
+
+/**
+ * \brief
+ * Beacon frame send by the gateway at the start of every superframe
+ * \details
+ * A superframe consists of slot_count slots of slot_length_ms each, the beacon is send at the start of slot 0.
+ */
+struct beacon_frame{
+	uint8_t type = beacon_type;
+	uint8_t slot_count = 0;
+	uint16_t slot_length_ms = 0;
+	uint32_t sequence = 0;
+};
+
+/**
+ * \brief
+ * Gateway side of the slotted listening mode
+ * \details
+ * Sends a beacon at the start of every superframe. The beacon is send without acknowledge
+ * so it can be recieved by any amount of nodes.
+ * @note The radio must be in TX mode when a beacon is due
+ */
+class beacon_sender
+{
+private:
+	rf24 & radio;
+	beacon_frame beacon;
+	uint64_t next_beacon;
+public:
+	/**
+	* \brief
+	* The beacon sender constructor
+	* @param radio			The radio the beacons are send with
+	* @param slot_count		The amount of slots per superframe, including the beacon slot, at most beacon_max_slots
+	* @param slot_length_ms	The length of each slot in ms
+	*/
+	beacon_sender(rf24 & radio, const uint8_t & slot_count, const uint16_t & slot_length_ms):
+		radio(radio),
+		next_beacon(hwlib::now_us())
+	{
+		if(slot_count > beacon_max_slots){
+			hwlib::cout << "Invalid slot count, " << hwlib::dec << beacon_max_slots << " slots will be used!\n";
+		}
+		beacon.slot_count = std::min(slot_count, beacon_max_slots);
+		beacon.slot_length_ms = slot_length_ms;
+	}
+
+	/**
+	* \brief
+	* Get the length of a superframe in microseconds
+	*/
+	uint32_t period_us(void) const {
+		return uint32_t(beacon.slot_count) * beacon.slot_length_ms * 1000;
+	}
+
+	/**
+	* \brief
+	* Get the time of the next beacon in microseconds
+	*/
+	uint64_t next_beacon_us(void) const {
+		return next_beacon;
+	}
+
+	/**
+	* \brief
+	* Send a beacon if one is due
+	* @returns True if a beacon has been send
+	*/
+	bool poll(void){
+		if(hwlib::now_us() < next_beacon){
+			return 0;
+		}
+		radio.write_no_ack(beacon);
+		beacon.sequence++;
+		next_beacon += period_us();
+		return 1;
+	}
+};
+
+/**
+ * \brief
+ * Node side of the slotted listening mode
+ * \details
+ * The listener searches for a beacon with the radio continuously in RX mode. Once synchronised the radio is
+ * only powered up around the beacon slot and the slots given in the slot mask, and powered down otherwise.
+ * The drift between the local clock and the gateway clock is measured from the beacon interval,
+ * the guard time around each slot grows with the measured drift and the time since the last beacon.
+ * @code
+ * // Listen in slot 3 of every superframe
+ * slotted_listener listener(radio, (1<<3));
+ * for(;;){
+ * 	if(listener.poll()){
+ * 		listener.read(data);
+ * 	}
+ * }
+ * @endcode
+ * @note poll() must be called frequently, the beacon arrival time is taken when poll() sees the beacon.
+ */
+class slotted_listener
+{
+private:
+	rf24 & radio;
+	uint32_t slot_mask;
+	uint16_t base_guard_us;
+	// Time needed to power up and enter RX mode before a slot starts
+	const uint16_t wake_up_us = 1700;
+	// Drift assumed until a drift has been measured, and the margin on a measured drift
+	const uint16_t default_drift_ppm = 100;
+	const uint16_t drift_margin_ppm = 20;
+
+	bool synced = false;
+	bool drift_known = false;
+	bool listening = false;
+	uint8_t slot_count = 0;
+	uint32_t slot_length_us = 0;
+	uint32_t last_sequence = 0;
+	uint64_t anchor_us = 0;
+	int32_t drift_ppm = 0;
+	uint64_t listen_time_us = 0;
+	uint64_t listen_since = 0;
+	uint64_t start_us;
+	uint32_t beacons = 0;
+	std::array<uint8_t, 32> frame;
+
+	uint32_t period_us(void) const {
+		return slot_count * slot_length_us;
+	}
+
+	bool listen_in_slot(int16_t slot) const {
+		slot = (slot + slot_count) % slot_count;
+		if(slot >= beacon_max_slots){
+			return 0;
+		}
+		return slot == 0 || (slot_mask & (uint32_t(1) << slot));
+	}
+
+	// Convert a local time to the time since the last beacon on the gateway clock
+	uint64_t gateway_elapsed(const uint64_t & now) const {
+		uint64_t elapsed = now - anchor_us;
+		return elapsed * 1000000 / (1000000 + drift_ppm);
+	}
+
+	bool in_window(const uint64_t & now) const {
+		uint64_t elapsed = gateway_elapsed(now);
+		uint32_t guard = guard_us(now);
+		uint32_t position = elapsed % period_us();
+		int16_t slot = position / slot_length_us;
+		uint32_t offset = position % slot_length_us;
+		if(listen_in_slot(slot)){
+			return 1;
+		}
+		if(listen_in_slot(slot + 1) && (slot_length_us - offset) < (guard + wake_up_us)){
+			return 1;
+		}
+		if(listen_in_slot(slot - 1) && offset < guard){
+			return 1;
+		}
+		return 0;
+	}
+
+	void open(const uint64_t & now){
+		radio.start_listening();
+		listening = true;
+		listen_since = now;
+	}
+
+	void close(const uint64_t & now){
+		radio.power_down();
+		listening = false;
+		listen_time_us += now - listen_since;
+	}
+
+	void handle_beacon(const uint64_t & now){
+		beacon_frame beacon;
+		uint8_t * data = reinterpret_cast<uint8_t *>(&beacon);
+		for(uint8_t i = 0; i < sizeof(beacon); i++){
+			data[i] = frame[i];
+		}
+		if(beacon.slot_count == 0 || beacon.slot_count > beacon_max_slots || beacon.slot_length_ms == 0){
+			return;
+		}
+		if(synced && beacon.sequence != last_sequence && beacon.slot_count == slot_count
+		   && uint32_t(beacon.slot_length_ms) * 1000 == slot_length_us){
+			int64_t expected = int64_t(beacon.sequence - last_sequence) * period_us();
+			int64_t measured = now - anchor_us;
+			int32_t drift = (measured - expected) * 1000000 / expected;
+			// Average the measurements to filter out the jitter of the beacon arrival time
+			drift_ppm = drift_known ? (3 * drift_ppm + drift) / 4 : drift;
+			drift_known = true;
+		}
+		slot_count = beacon.slot_count;
+		slot_length_us = uint32_t(beacon.slot_length_ms) * 1000;
+		last_sequence = beacon.sequence;
+		anchor_us = now;
+		synced = true;
+		beacons++;
+	}
+
+public:
+	/**
+	* \brief
+	* The slotted listener constructor
+	* @param radio			The radio to listen with, the recieving address must already be set
+	* @param slot_mask		Bitmask of the slots to listen in, the beacon slot 0 is always listened to
+	* @param base_guard_us	Minimum guard time before and after each slot in microseconds
+	*/
+	slotted_listener(rf24 & radio, const uint32_t & slot_mask, const uint16_t & base_guard_us = 500):
+		radio(radio),
+		slot_mask(slot_mask),
+		base_guard_us(base_guard_us),
+		start_us(hwlib::now_us())
+	{}
+
+	/**
+	* \brief
+	* Open or close the recieve window and handle recieved frames
+	* @returns True if an application frame has been recieved, read it with read()
+	*/
+	bool poll(void){
+		uint64_t now = hwlib::now_us();
+		if(synced){
+			// Fall back to continuous listening when the guard time no longer fits in a slot
+			if(guard_us(now) > slot_length_us / 2){
+				synced = false;
+				drift_known = false;
+			}
+		}
+		bool listen = !synced || in_window(now);
+		if(listen && !listening){
+			open(now);
+		}else if(!listen && listening){
+			close(now);
+		}
+		if(listening && radio.data_available()){
+			radio.read(frame);
+			if(frame[0] == beacon_type){
+				handle_beacon(hwlib::now_us());
+				return 0;
+			}
+			return 1;
+		}
+		return 0;
+	}
+
+	/**
+	* \brief
+	* Read the last recieved application frame
+	*/
+	template<typename datatype>
+	void read(datatype & d){
+		uint8_t * data = reinterpret_cast<uint8_t *>(&d);
+		for(uint8_t i = 0; i < std::min(sizeof(d), frame.size()); i++){
+			data[i] = frame[i];
+		}
+	}
+
+	/**
+	* \brief
+	* Check if the listener is synchronised to the gateway
+	*/
+	bool is_synced(void) const {
+		return synced;
+	}
+
+	/**
+	* \brief
+	* Get the measured clock drift relative to the gateway in ppm
+	* \details
+	* A positive value means the local clock runs faster than the gateway clock.
+	*/
+	int32_t get_drift_ppm(void) const {
+		return drift_ppm;
+	}
+
+	/**
+	* \brief
+	* Get the guard time at the given time in microseconds
+	*/
+	uint32_t guard_us(const uint64_t & now) const {
+		uint32_t drift = (drift_known ? std::abs(drift_ppm) : default_drift_ppm) + drift_margin_ppm;
+		return base_guard_us + (now - anchor_us) * drift / 1000000;
+	}
+
+	/**
+	* \brief
+	* Get the part of the time the radio has been listening in 1/1000
+	*/
+	uint16_t duty_cycle_permille(void) const {
+		uint64_t now = hwlib::now_us();
+		uint64_t listened = listen_time_us + (listening ? now - listen_since : 0);
+		return listened * 1000 / (now - start_us + 1);
+	}
+
+	/**
+	* \brief
+	* Print the synchronisation state
+	*/
+	void print_status(void) const {
+		hwlib::cout << "Synced: " << synced
+					<< "\tBeacons: " << hwlib::dec << beacons
+					<< "\tDrift: " << drift_ppm << "ppm"
+					<< "\tDuty cycle: " << duty_cycle_permille() << "/1000\n";
+	}
+};
+
+#endif // SLOTTED_LISTENER_HPP
@@ -0,0 +1,409 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef SPI_TRACE_HPP
+#define SPI_TRACE_HPP
+#include "hwlib.hpp"
+#include "nrf24l01.hpp"
+/**
+ * @file spi_trace.hpp
+ */
+
+/**
+ * \brief
+ * A single recorded SPI transaction
+ * \details
+ * Only the first bytes clocked out by the chip are stored, this is the STATUS byte
+ * followed by at most 5 register bytes. Payload data beyond that is not recorded.
+ */
+struct spi_transaction{
+	uint8_t command = 0;
+	uint8_t length = 0;
+	uint32_t start_us = 0;
+	uint16_t duration_us = 0;
+	std::array<uint8_t, 6> response = {0};
+};
+
+/**
+* \brief
+* Get the name of a command byte
+* \details
+* Decodes the command byte against the commands enum in nrf24l01.hpp.
+* For R_REGISTER and W_REGISTER use register_name() to get the register that is accessed.
+*/
+inline const char * command_name(const uint8_t & command){
+	if(command < W_REGISTER){
+		return "R_REGISTER";
+	}else if(command < R_RX_PL_WID){
+		return "W_REGISTER";
+	}
+	switch(command){
+		case R_RX_PL_WID:			return "R_RX_PL_WID";
+		case R_RX_PAYLOAD:			return "R_RX_PAYLOAD";
+		case W_TX_PAYLOAD:			return "W_TX_PAYLOAD";
+		case W_TX_PAYLOAD_NO_ACK:	return "W_TX_PAYLOAD_NO_ACK";
+		case FLUSH_TX:				return "FLUSH_TX";
+		case FLUSH_RX:				return "FLUSH_RX";
+		case REUSE_TX_PL:			return "REUSE_TX_PL";
+		case RF24_NOP:				return "RF24_NOP";
+	}
+	// W_ACK_PAYLOAD has the pipe number in the lower 3 bits
+	if((command & 0xF8) == W_ACK_PAYLOAD){
+		return "W_ACK_PAYLOAD";
+	}
+	return "UNKNOWN";
+}
+
+/**
+* \brief
+* Get the name of a register
+* \details
+* Decodes the lower 5 bits of a R_REGISTER or W_REGISTER command against the memory_map enum in nrf24l01.hpp.
+*/
+inline const char * register_name(const uint8_t & command){
+	switch(command & 0x1F){
+		case NRF_CONFIG:	return "CONFIG";
+		case EN_AA:			return "EN_AA";
+		case EN_RXADDR:		return "EN_RXADDR";
+		case SETUP_AW:		return "SETUP_AW";
+		case SETUP_RETR:	return "SETUP_RETR";
+		case RF_CH:			return "RF_CH";
+		case RF_SETUP:		return "RF_SETUP";
+		case NRF_STATUS:	return "STATUS";
+		case OBSERVE_TX:	return "OBSERVE_TX";
+		case RPD:			return "RPD";
+		case RX_ADDR_P0:	return "RX_ADDR_P0";
+		case RX_ADDR_P1:	return "RX_ADDR_P1";
+		case RX_ADDR_P2:	return "RX_ADDR_P2";
+		case RX_ADDR_P3:	return "RX_ADDR_P3";
+		case RX_ADDR_P4:	return "RX_ADDR_P4";
+		case RX_ADDR_P5:	return "RX_ADDR_P5";
+		case TX_ADDR:		return "TX_ADDR";
+		case RX_PW_P0:		return "RX_PW_P0";
+		case RX_PW_P1:		return "RX_PW_P1";
+		case RX_PW_P2:		return "RX_PW_P2";
+		case RX_PW_P3:		return "RX_PW_P3";
+		case RX_PW_P4:		return "RX_PW_P4";
+		case RX_PW_P5:		return "RX_PW_P5";
+		case FIFO_STATUS:	return "FIFO_STATUS";
+		case DYNPD:			return "DYNPD";
+		case FEATURE:		return "FEATURE";
+	}
+	return "UNKNOWN";
+}
+
+/**
+* \brief
+* Print a decoded SPI transaction
+* \details
+* Prints the command and register name, the length and the time the transaction took.
+*/
+inline void print_transaction(const spi_transaction & t){
+	hwlib::cout << hwlib::dec << t.start_us << "us\t" << command_name(t.command);
+	if(t.command < R_RX_PL_WID){
+		hwlib::cout << " " << register_name(t.command);
+	}
+	hwlib::cout << "\t" << t.length << " bytes\t" << t.duration_us << "us"
+				<< "\tSTATUS=0x" << hwlib::hex << t.response[0] << hwlib::dec << '\n';
+}
+
+/**
+ * \brief
+ * SPI bus decorator which records every transaction
+ * \details
+ * Place this class between the spi bus and the rf24 object to record the command byte, length and timing
+ * of each transaction. The recording stops when the buffer is full, further transactions are only counted.
+ * @code
+ * auto spi_bus = hwlib::spi_bus_bit_banged_sclk_mosi_miso(SCK, MOSI, MISO);
+ * spi_trace<64> trace(spi_bus);
+ * rf24 radio(trace, CE, CSN);
+ * radio.begin();
+ * trace.print_report();
+ * @endcode
+ */
+template<size_t capacity>
+class spi_trace : public hwlib::spi_bus
+{
+private:
+	hwlib::spi_bus & bus;
+	std::array<spi_transaction, capacity> transactions;
+	size_t count = 0;
+	size_t dropped = 0;
+	bool recording = true;
+
+	struct operation_summary{
+		uint8_t command = 0;
+		uint32_t calls = 0;
+		uint32_t bytes = 0;
+		uint32_t time_us = 0;
+	};
+	// The driver uses a few dozen distinct command bytes, any further commands are reported together
+	static const size_t report_operations = (capacity < 48) ? capacity : 48;
+public:
+	using hwlib::spi_bus::write_and_read;
+
+	/**
+	* \brief
+	* The trace constructor
+	* @param bus	The SPI-bus which is actually connected to the module
+	*/
+	spi_trace(hwlib::spi_bus & bus):
+		bus(bus)
+	{}
+
+	/**
+	* \brief
+	* Forward a transaction to the real bus and record it
+	*/
+	void write_and_read(hwlib::pin_out & sel, const size_t n, const uint8_t data_out[], uint8_t data_in[]) override {
+		// rf24 uses one buffer for both directions, so the command is gone after the transfer
+		uint8_t command = (data_out == nullptr) ? uint8_t(RF24_NOP) : data_out[0];
+		uint32_t start = hwlib::now_us();
+		bus.write_and_read(sel, n, data_out, data_in);
+		uint32_t end = hwlib::now_us();
+		if(!recording){
+			return;
+		}
+		if(count >= capacity){
+			dropped++;
+			return;
+		}
+		spi_transaction & t = transactions[count++];
+		t.command = command;
+		t.length = n;
+		t.start_us = start;
+		t.duration_us = end - start;
+		t.response = {0};
+		if(data_in != nullptr){
+			for(size_t i = 0; i < std::min(n, t.response.size()); i++){
+				t.response[i] = data_in[i];
+			}
+		}
+	}
+
+	/**
+	* \brief
+	* Resume recording
+	*/
+	void start(void){
+		recording = true;
+	}
+
+	/**
+	* \brief
+	* Pause recording, transactions are still forwarded to the bus
+	*/
+	void stop(void){
+		recording = false;
+	}
+
+	/**
+	* \brief
+	* Clear the recorded transactions
+	*/
+	void clear(void){
+		count = 0;
+		dropped = 0;
+	}
+
+	/**
+	* \brief
+	* Get the amount of recorded transactions
+	*/
+	size_t size(void) const {
+		return count;
+	}
+
+	/**
+	* \brief
+	* Get the amount of transactions which did not fit in the buffer
+	*/
+	size_t overflow(void) const {
+		return dropped;
+	}
+
+	/**
+	* \brief
+	* Get a recorded transaction
+	*/
+	const spi_transaction & operator[](const size_t & index) const {
+		return transactions[index];
+	}
+
+	/**
+	* \brief
+	* Get the total bus time of all recorded transactions in microseconds
+	*/
+	uint32_t bus_time_us(void) const {
+		uint32_t total = 0;
+		for(size_t i = 0; i < count; i++){
+			total += transactions[i].duration_us;
+		}
+		return total;
+	}
+
+	/**
+	* \brief
+	* Get the total amount of bytes of all recorded transactions
+	*/
+	uint32_t bus_bytes(void) const {
+		uint32_t total = 0;
+		for(size_t i = 0; i < count; i++){
+			total += transactions[i].length;
+		}
+		return total;
+	}
+
+	/**
+	* \brief
+	* Print every recorded transaction
+	*/
+	void print_trace(void) const {
+		for(size_t i = 0; i < count; i++){
+			print_transaction(transactions[i]);
+		}
+	}
+
+	/**
+	* \brief
+	* Print the amount of bytes and bus time per operation
+	* \details
+	* Transactions are grouped by their command byte, so register accesses are reported per register.
+	*/
+	void print_report(void) const {
+		std::array<operation_summary, report_operations> summary;
+		operation_summary other;
+		size_t operations = 0;
+		for(size_t i = 0; i < count; i++){
+			size_t j = 0;
+			while(j < operations && summary[j].command != transactions[i].command){
+				j++;
+			}
+			if(j == operations && operations < report_operations){
+				summary[operations++].command = transactions[i].command;
+			}
+			operation_summary & s = (j < operations) ? summary[j] : other;
+			s.calls++;
+			s.bytes += transactions[i].length;
+			s.time_us += transactions[i].duration_us;
+		}
+		hwlib::cout << "SPI trace report\n\n";
+		for(size_t j = 0; j < operations; j++){
+			hwlib::cout << command_name(summary[j].command);
+			if(summary[j].command < R_RX_PL_WID){
+				hwlib::cout << " " << register_name(summary[j].command);
+			}
+			hwlib::cout << "\t calls=" << hwlib::dec << summary[j].calls
+						<< " bytes=" << summary[j].bytes
+						<< " time=" << summary[j].time_us << "us\n";
+		}
+		if(other.calls){
+			hwlib::cout << "Other commands\t calls=" << hwlib::dec << other.calls
+						<< " bytes=" << other.bytes
+						<< " time=" << other.time_us << "us\n";
+		}
+		hwlib::cout << "Total\t\t transactions=" << count
+					<< " bytes=" << bus_bytes()
+					<< " time=" << bus_time_us() << "us";
+		if(dropped){
+			hwlib::cout << " (" << dropped << " not recorded)";
+		}
+		hwlib::cout << "\n\n";
+	}
+};
+
+/**
+ * \brief
+ * Mock chip which replays a recorded trace
+ * \details
+ * Each transaction is answered with the response bytes from the trace, so the rf24 driver can be run
+ * without a module attached. The command byte and length of every transaction are compared
+ * with the trace, any difference is counted as a mismatch. This makes it possible to catch changes
+ * in the transactions the driver issues for a given API call.
+ */
+class spi_replay : public hwlib::spi_bus
+{
+private:
+	const spi_transaction * transactions;
+	size_t count;
+	size_t position = 0;
+	size_t errors = 0;
+public:
+	using hwlib::spi_bus::write_and_read;
+
+	/**
+	* \brief
+	* The replay constructor
+	* @param transactions	The recorded transactions
+	* @param count			The amount of recorded transactions
+	*/
+	spi_replay(const spi_transaction * transactions, const size_t & count):
+		transactions(transactions),
+		count(count)
+	{}
+
+	/**
+	* \brief
+	* Replay a recorded trace
+	*/
+	template<size_t capacity>
+	spi_replay(const spi_trace<capacity> & trace):
+		transactions(&trace[0]),
+		count(trace.size())
+	{}
+
+	/**
+	* \brief
+	* Answer a transaction from the trace
+	*/
+	void write_and_read(hwlib::pin_out &, const size_t n, const uint8_t data_out[], uint8_t data_in[]) override {
+		if(position >= count){
+			errors++;
+			if(data_in != nullptr){
+				for(size_t i = 0; i < n; i++){
+					data_in[i] = 0;
+				}
+			}
+			return;
+		}
+		const spi_transaction & t = transactions[position++];
+		uint8_t command = (data_out == nullptr) ? uint8_t(RF24_NOP) : data_out[0];
+		if(command != t.command || n != t.length){
+			errors++;
+		}
+		if(data_in != nullptr){
+			for(size_t i = 0; i < n; i++){
+				data_in[i] = (i < t.response.size()) ? t.response[i] : 0;
+			}
+		}
+	}
+
+	/**
+	* \brief
+	* Start again at the first transaction of the trace
+	*/
+	void rewind(void){
+		position = 0;
+		errors = 0;
+	}
+
+	/**
+	* \brief
+	* Check if all transactions in the trace have been replayed
+	*/
+	bool finished(void) const {
+		return position == count;
+	}
+
+	/**
+	* \brief
+	* Get the amount of transactions which did not match the trace
+	*/
+	size_t mismatches(void) const {
+		return errors;
+	}
+};
+
+#endif // SPI_TRACE_HPP
@@ -0,0 +1,570 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef TDMA_HPP
+#define TDMA_HPP
+#include "rf24.hpp"
+#include "slotted_listener.hpp"
+#include "hwlib.hpp"
+/**
+ * @file tdma.hpp
+ */
+
+/**
+ * \brief
+ * Frame types used by the TDMA MAC
+ */
+enum tdma_frame_type: uint8_t{
+	tdma_join		= 0xA1,
+	tdma_leave		= 0xA2,
+	tdma_keepalive	= 0xA3,
+	tdma_data		= 0xDA
+};
+
+/**
+ * \brief
+ * TDMA beacon
+ * \details
+ * Starts with a beacon_frame so a slotted_listener can synchronise to it as well.
+ * Every beacon grants at most one slot, the node with grant_node uses slot grant_slot from then on.
+ * Slot 0 is the beacon slot and slot 1 is the contention slot for join requests.
+ */
+struct tdma_beacon{
+	beacon_frame beacon;
+	uint16_t grant_node = 0xFFFF;
+	uint8_t grant_slot = 0;
+	uint8_t free_slots = 0;
+};
+
+/**
+ * \brief
+ * Join, leave and keepalive request send by a node
+ */
+struct tdma_request{
+	uint8_t type = tdma_join;
+	uint8_t slot = 0;
+	uint16_t node = 0;
+};
+
+/**
+ * \brief
+ * Header in front of the data send by a node
+ */
+struct tdma_data_header{
+	uint8_t type = tdma_data;
+	uint8_t slot = 0;
+	uint16_t node = 0;
+};
+
+/**
+ * \brief
+ * Maximum amount of data bytes in a TDMA data frame
+ */
+const uint8_t tdma_payload_size = 32 - sizeof(tdma_data_header);
+
+/**
+ * \brief
+ * Superframes without a frame from a node after which the gateway frees its slot
+ */
+const uint8_t tdma_expire_superframes = 16;
+
+/**
+ * \brief
+ * Superframes without an acknowledged frame in the own slot after which a node sends a keepalive
+ */
+const uint8_t tdma_keepalive_superframes = tdma_expire_superframes / 2;
+
+/**
+ * \brief
+ * Default address of the gateway
+ */
+const std::array<uint8_t, 5> tdma_gateway_address = {0xD1, 0xA7, 0xA7, 0xA7, 0xA7};
+
+/**
+ * \brief
+ * Default address the beacons are send to
+ */
+const std::array<uint8_t, 5> tdma_beacon_address = {0xB1, 0xA7, 0xA7, 0xA7, 0xA7};
+
+/**
+ * \brief
+ * Gateway side of the TDMA MAC
+ * \details
+ * The gateway sends a beacon at the start of every superframe and listens for the rest of the superframe.
+ * Join requests in the contention slot are answered with a slot grant in the next beacon.
+ * A slot is freed when the node leaves or has not been heard from for tdma_expire_superframes,
+ * data frames and keepalives both count.
+ * @code
+ * tdma_gateway<8> gateway(radio);
+ * gateway.begin();
+ * for(;;){
+ * 	if(gateway.poll()){
+ * 		gateway.read(data);
+ * 	}
+ * }
+ * @endcode
+ */
+template<uint8_t max_nodes = 8>
+class tdma_gateway
+{
+private:
+	static_assert(max_nodes > 0 && max_nodes <= beacon_max_slots - 2, "A superframe has at most 32 slots");
+
+	struct assignment{
+		bool used = false;
+		uint16_t node = 0;
+		uint32_t last_heard = 0;
+		uint32_t frames = 0;
+	};
+
+	rf24 & radio;
+	std::array<uint8_t, 5> gateway_address;
+	std::array<uint8_t, 5> beacon_address;
+	tdma_beacon beacon;
+	uint64_t next_beacon = 0;
+	std::array<assignment, max_nodes> table;
+	std::array<uint8_t, 32> frame;
+	uint16_t frame_node = 0;
+
+	void send_beacon(void){
+		uint8_t free_slots = 0;
+		for(auto & a : table){
+			if(a.used && beacon.beacon.sequence - a.last_heard > tdma_expire_superframes){
+				a.used = false;
+			}
+			if(!a.used){
+				free_slots++;
+			}
+		}
+		beacon.free_slots = free_slots;
+		radio.enter_tx_mode();
+		radio.set_transmit_address(beacon_address);
+		radio.write_no_ack(beacon);
+		radio.wait_for_transmission(1000);
+		radio.enter_rx_mode();
+		beacon.beacon.sequence++;
+		// Every grant is announced once, a node which missed it sends a new join request
+		beacon.grant_node = 0xFFFF;
+	}
+
+	void handle_request(const tdma_request & request){
+		if(request.type == tdma_leave){
+			for(auto & a : table){
+				if(a.used && a.node == request.node){
+					a.used = false;
+				}
+			}
+			return;
+		}
+		if(request.type == tdma_keepalive){
+			uint8_t index = request.slot - 2;
+			if(index < max_nodes && table[index].used && table[index].node == request.node){
+				table[index].last_heard = beacon.beacon.sequence;
+			}
+			return;
+		}
+		int16_t index = -1;
+		for(uint8_t i = 0; i < max_nodes; i++){
+			if(table[i].used && table[i].node == request.node){
+				index = i;
+			}
+		}
+		for(uint8_t i = 0; i < max_nodes && index < 0; i++){
+			if(!table[i].used){
+				index = i;
+			}
+		}
+		if(index < 0){
+			return;
+		}
+		table[index].used = true;
+		table[index].node = request.node;
+		table[index].last_heard = beacon.beacon.sequence;
+		beacon.grant_node = request.node;
+		beacon.grant_slot = index + 2;
+	}
+
+public:
+	/**
+	* \brief
+	* The TDMA gateway constructor
+	* @param radio				The radio of the gateway
+	* @param slot_length_ms		The length of a slot in ms, must fit a transmission including retransmissions
+	* @param gateway_address	The address the nodes send to
+	* @param beacon_address		The address the beacons are send to
+	*/
+	tdma_gateway(rf24 & radio, const uint16_t & slot_length_ms = 10,
+	             const std::array<uint8_t, 5> & gateway_address = tdma_gateway_address,
+	             const std::array<uint8_t, 5> & beacon_address = tdma_beacon_address):
+		radio(radio),
+		gateway_address(gateway_address),
+		beacon_address(beacon_address)
+	{
+		beacon.beacon.slot_count = max_nodes + 2;
+		beacon.beacon.slot_length_ms = slot_length_ms;
+	}
+
+	/**
+	* \brief
+	* Begin operation of the gateway
+	*/
+	void begin(void){
+		radio.set_recieve_address(1, gateway_address);
+		radio.start_listening();
+		next_beacon = hwlib::now_us();
+	}
+
+	/**
+	* \brief
+	* Send the beacon when it is due and handle recieved frames
+	* @returns True if a data frame has been recieved, read it with read()
+	*/
+	bool poll(void){
+		if(hwlib::now_us() >= next_beacon){
+			send_beacon();
+			next_beacon += uint32_t(beacon.beacon.slot_count) * beacon.beacon.slot_length_ms * 1000;
+		}
+		while(radio.data_available()){
+			radio.read(frame);
+			if(frame[0] == tdma_join || frame[0] == tdma_leave || frame[0] == tdma_keepalive){
+				tdma_request request;
+				uint8_t * data = reinterpret_cast<uint8_t *>(&request);
+				for(uint8_t i = 0; i < sizeof(request); i++){
+					data[i] = frame[i];
+				}
+				handle_request(request);
+			}else if(frame[0] == tdma_data){
+				tdma_data_header header;
+				uint8_t * data = reinterpret_cast<uint8_t *>(&header);
+				for(uint8_t i = 0; i < sizeof(header); i++){
+					data[i] = frame[i];
+				}
+				uint8_t index = header.slot - 2;
+				if(index < max_nodes && table[index].used && table[index].node == header.node){
+					table[index].last_heard = beacon.beacon.sequence;
+					table[index].frames++;
+				}
+				frame_node = header.node;
+				return 1;
+			}
+		}
+		return 0;
+	}
+
+	/**
+	* \brief
+	* Read the data of the last recieved data frame
+	*/
+	template<typename datatype>
+	void read(datatype & d){
+		uint8_t * data = reinterpret_cast<uint8_t *>(&d);
+		for(uint8_t i = 0; i < std::min(sizeof(d), size_t(tdma_payload_size)); i++){
+			data[i] = frame[i + sizeof(tdma_data_header)];
+		}
+	}
+
+	/**
+	* \brief
+	* Get the node which has send the last recieved data frame
+	*/
+	uint16_t last_node(void) const {
+		return frame_node;
+	}
+
+	/**
+	* \brief
+	* Get the amount of nodes with a slot
+	*/
+	uint8_t nodes(void) const {
+		uint8_t count = 0;
+		for(const auto & a : table){
+			count += a.used;
+		}
+		return count;
+	}
+
+	/**
+	* \brief
+	* Print the slot assignments
+	*/
+	void print_status(void) const {
+		hwlib::cout << "TDMA superframe " << hwlib::dec << beacon.beacon.sequence << '\n';
+		for(uint8_t i = 0; i < max_nodes; i++){
+			if(table[i].used){
+				hwlib::cout << "slot " << (i + 2) << "\t node=" << table[i].node << " frames=" << table[i].frames << '\n';
+			}
+		}
+	}
+};
+
+/**
+ * \brief
+ * Node side of the TDMA MAC
+ * \details
+ * The node synchronises to the beacon and sends a join request in the contention slot, retrying after a random
+ * amount of superframes when no grant is recieved. Once it has a slot, data given to write() is send at the start
+ * of the next occurence of that slot, one frame per superframe. Between transmissions the radio is in RX mode.
+ * When nothing has been acknowledged in the own slot for tdma_keepalive_superframes, a keepalive is send in the
+ * own slot every superframe until the gateway acknowledges one, so the gateway keeps the slot.
+ * When no frame in the own slot has been acknowledged for tdma_expire_superframes, the gateway may have given
+ * the slot away and the node joins again.
+ */
+class tdma_node
+{
+private:
+	rf24 & radio;
+	uint16_t node_id;
+	std::array<uint8_t, 5> gateway_address;
+	std::array<uint8_t, 5> beacon_address;
+	// Time after the slot start before transmitting, covers the beacon arrival jitter
+	const uint16_t slot_guard_us = 300;
+
+	bool synced = false;
+	uint8_t slot = 0;
+	uint8_t slot_count = 0;
+	uint32_t slot_length_us = 0;
+	uint64_t anchor_us = 0;
+	uint32_t sequence = 0;
+	uint32_t last_tx_superframe = 0xFFFFFFFF;
+	uint32_t last_acked_superframe = 0;
+	uint8_t backoff = 0;
+	uint32_t random_state;
+	bool leaving = false;
+
+	tdma_data_header header;
+	std::array<uint8_t, tdma_payload_size> pending;
+	bool pending_ready = false;
+
+	uint32_t sent = 0;
+	uint32_t failed = 0;
+
+	uint8_t random(const uint8_t & range){
+		// xorshift32
+		random_state ^= random_state << 13;
+		random_state ^= random_state >> 17;
+		random_state ^= random_state << 5;
+		return random_state % range;
+	}
+
+	template<typename datatype>
+	bool transmit(const datatype & d){
+		radio.enter_tx_mode();
+		// Pipe 0 recieves the acknowledge from the gateway
+		radio.enable_pipe(0);
+		bool result = radio.write(d) && radio.wait_for_transmission(slot_length_us);
+		// Do not recieve the frames of other nodes to the gateway
+		radio.disable_pipe(0);
+		radio.enter_rx_mode();
+		return result;
+	}
+
+	void handle_beacon(const std::array<uint8_t, 32> & frame, const uint64_t & now){
+		tdma_beacon b;
+		uint8_t * data = reinterpret_cast<uint8_t *>(&b);
+		for(uint8_t i = 0; i < sizeof(b); i++){
+			data[i] = frame[i];
+		}
+		if(b.beacon.slot_count < 3 || b.beacon.slot_count > beacon_max_slots || b.beacon.slot_length_ms == 0){
+			return;
+		}
+		slot_count = b.beacon.slot_count;
+		slot_length_us = uint32_t(b.beacon.slot_length_ms) * 1000;
+		sequence = b.beacon.sequence;
+		anchor_us = now;
+		synced = true;
+		if(b.grant_node == node_id && !leaving){
+			slot = b.grant_slot;
+			last_acked_superframe = sequence;
+		}
+	}
+
+	void transmit_in_slot(const uint32_t & superframe){
+		last_tx_superframe = superframe;
+		if(leaving){
+			tdma_request request;
+			request.type = tdma_leave;
+			request.slot = slot;
+			request.node = node_id;
+			transmit(request);
+			slot = 0;
+			leaving = false;
+			return;
+		}
+		if(!pending_ready){
+			tdma_request request;
+			request.type = tdma_keepalive;
+			request.slot = slot;
+			request.node = node_id;
+			if(transmit(request)){
+				last_acked_superframe = superframe;
+			}
+			return;
+		}
+		std::array<uint8_t, 32> frame = {0};
+		header.slot = slot;
+		const uint8_t * h = reinterpret_cast<const uint8_t *>(&header);
+		for(uint8_t i = 0; i < sizeof(header); i++){
+			frame[i] = h[i];
+		}
+		for(uint8_t i = 0; i < tdma_payload_size; i++){
+			frame[i + sizeof(header)] = pending[i];
+		}
+		if(transmit(frame)){
+			sent++;
+			pending_ready = false;
+			last_acked_superframe = superframe;
+		}else{
+			failed++;
+		}
+	}
+
+	void join(const uint32_t & superframe){
+		last_tx_superframe = superframe;
+		if(backoff > 0){
+			backoff--;
+			return;
+		}
+		tdma_request request;
+		request.node = node_id;
+		transmit(request);
+		// Wait for the grant, retry after a random amount of superframes if it does not come
+		backoff = 1 + random(4);
+	}
+
+public:
+	/**
+	* \brief
+	* The TDMA node constructor
+	* @param radio				The radio of the node
+	* @param node_id			Unique id of the node, 0xFFFF is reserved
+	* @param gateway_address	The address of the gateway
+	* @param beacon_address		The address the beacons are send to
+	*/
+	tdma_node(rf24 & radio, const uint16_t & node_id,
+	          const std::array<uint8_t, 5> & gateway_address = tdma_gateway_address,
+	          const std::array<uint8_t, 5> & beacon_address = tdma_beacon_address):
+		radio(radio),
+		node_id(node_id),
+		gateway_address(gateway_address),
+		beacon_address(beacon_address),
+		random_state(0x9E3779B9 ^ node_id)
+	{
+		header.node = node_id;
+	}
+
+	/**
+	* \brief
+	* Begin operation of the node
+	*/
+	void begin(void){
+		radio.set_recieve_address(1, beacon_address);
+		radio.set_transmit_address(gateway_address);
+		radio.disable_pipe(0);
+		radio.start_listening();
+	}
+
+	/**
+	* \brief
+	* Handle beacons and transmit in the contention slot or the own slot
+	* \details
+	* Call this function often, transmissions only happen from within this function.
+	*/
+	void poll(void){
+		uint64_t now = hwlib::now_us();
+		std::array<uint8_t, 32> frame;
+		while(radio.data_available()){
+			radio.read(frame);
+			if(frame[0] == beacon_type){
+				handle_beacon(frame, now);
+			}
+		}
+		if(!synced){
+			return;
+		}
+		uint32_t period = slot_count * slot_length_us;
+		uint64_t elapsed = now - anchor_us;
+		// Lost the beacon for too long, search again
+		if(elapsed > 4 * uint64_t(period)){
+			synced = false;
+			return;
+		}
+		uint32_t superframe = sequence + elapsed / period;
+		uint32_t position = elapsed % period;
+		uint8_t current_slot = position / slot_length_us;
+		uint32_t offset = position % slot_length_us;
+		if(offset < slot_guard_us || superframe == last_tx_superframe){
+			return;
+		}
+		// The gateway has not acknowledged anything in the own slot for too long, it may have freed the slot
+		if(slot != 0 && superframe - last_acked_superframe >= tdma_expire_superframes){
+			slot = 0;
+			leaving = false;
+		}
+		if(slot == 0 && current_slot == 1){
+			join(superframe);
+		}else if(slot != 0 && current_slot == slot &&
+		         (pending_ready || leaving || superframe - last_acked_superframe >= tdma_keepalive_superframes)){
+			transmit_in_slot(superframe);
+		}
+	}
+
+	/**
+	* \brief
+	* Queue data for the next own slot
+	* @returns False if the previous data has not been send yet
+	*/
+	template<typename datatype>
+	bool write(const datatype & d){
+		static_assert(sizeof(d) <= tdma_payload_size, "Data does not fit in a TDMA frame");
+		if(pending_ready){
+			return 0;
+		}
+		pending = {0};
+		const uint8_t * data = reinterpret_cast<const uint8_t *>(&d);
+		for(uint8_t i = 0; i < sizeof(d); i++){
+			pending[i] = data[i];
+		}
+		pending_ready = true;
+		return 1;
+	}
+
+	/**
+	* \brief
+	* Give the slot back to the gateway in the next own slot
+	*/
+	void leave(void){
+		if(slot != 0){
+			leaving = true;
+		}
+	}
+
+	/**
+	* \brief
+	* Check if the node has a slot
+	*/
+	bool joined(void) const {
+		return slot != 0;
+	}
+
+	/**
+	* \brief
+	* Get the own slot, 0 if the node has no slot
+	*/
+	uint8_t get_slot(void) const {
+		return slot;
+	}
+
+	/**
+	* \brief
+	* Print the node state
+	*/
+	void print_status(void) const {
+		hwlib::cout << "TDMA node " << hwlib::dec << node_id
+					<< "\tsynced=" << synced << " slot=" << slot
+					<< " sent=" << sent << " failed=" << failed << '\n';
+	}
+};
+
+#endif // TDMA_HPP
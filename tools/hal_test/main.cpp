@@ -0,0 +1,236 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+// Host tool that checks the hardware abstraction on Linux.
+//   hal_test                                  rf24 on two emulated radios and the loopback bus
+//   hal_test -loopback /dev/spidev0.0         spidev with MOSI wired to MISO
+//   hal_test -radio /dev/spidev0.0 <ce gpio>  a real radio on spidev, freshly powered up
+// The exit code is 0 when all checks passed.
+
+#include "hwlib.hpp"
+#include "rf24.hpp"
+#include "nrf24l01.hpp"
+#include "rf24_emulator.hpp"
+#include "linux_hal.hpp"
+#include "rf_test.hpp"
+#include "rf24_async.hpp"
+#include "multi_radio.hpp"
+#include "spi_trace.hpp"
+#include <cstring>
+#include <cstdlib>
+
+bool failed = false;
+
+void check(const bool & passed, const char * name){
+	hwlib::cout << (passed ? "[OK]\t" : "[FAIL]\t") << name << '\n';
+	failed |= !passed;
+}
+
+void test_loopback(hwlib::spi_bus & bus){
+	hwlib::cout << "\nTesting the bus with MOSI wired to MISO\n";
+	unused_pin sel;
+	std::array<uint8_t, 33> out;
+	std::array<uint8_t, 33> in = {0};
+	for(uint8_t i = 0; i < out.size(); i++){
+		out[i] = uint8_t(i * 37 + 1);
+	}
+	bus.write_and_read(sel, out.size(), out.begin(), in.begin());
+	check(in == out, "Separate buffers");
+	// rf24 uses one buffer for both directions
+	in = out;
+	bus.write_and_read(sel, in.size(), in.begin(), in.begin());
+	check(in == out, "Same buffer for data out and in");
+	bus.write_and_read(sel, out.size(), out.begin(), nullptr);
+	check(true, "Transaction without data in");
+}
+
+void test_emulator(void){
+	hwlib::cout << "\nTesting rf24 on two emulated radios\n";
+	rf24_emulator air_1;
+	rf24_emulator air_2;
+	air_1.connect(air_2);
+	unused_pin ce_1, csn_1, ce_2, csn_2;
+	rf24 radio_1(air_1, ce_1, csn_1);
+	rf24 radio_2(air_2, ce_2, csn_2);
+
+	std::array<uint8_t, 5> default_addr = {0xE7, 0xE7, 0xE7, 0xE7, 0xE7};
+	check(radio_1.read_register_5byte(R_REGISTER + RX_ADDR_P0) == default_addr, "Reset value of RX_ADDR_P0");
+	radio_1.begin();
+	radio_2.begin();
+	radio_1.set_channel(76);
+	radio_2.set_channel(76);
+	check(radio_1.get_channel() == 76, "set_channel");
+	std::array<uint8_t, 5> address = {0x1F, 0xAC, 0xAC, 0xAC, 0xAC};
+	radio_1.set_transmit_address(address);
+	radio_2.set_transmit_address(address);
+	check(radio_1.read_register_5byte(R_REGISTER + TX_ADDR) == address, "set_transmit_address");
+
+	struct package{
+		uint8_t temperature;
+		uint8_t humidity;
+	};
+	package sent = {26, 78};
+	package recieved = {0, 0};
+	radio_1.enter_tx_mode();
+	radio_2.enter_rx_mode();
+	check(radio_1.write(sent), "write");
+	check(radio_1.wait_for_transmission(), "Transmission acknowledged");
+	check(radio_2.data_available(), "data_available");
+	radio_2.read(recieved);
+	check(recieved.temperature == sent.temperature && recieved.humidity == sent.humidity, "Recieved data equals send data");
+	check(!radio_2.data_available(), "RX FIFO empty after read");
+
+	radio_2.power_down();
+	std::array<uint8_t, 32> frame = {1, 2, 3};
+	radio_1.write_payload(frame, 3);
+	check(!radio_1.wait_for_transmission(), "Transmission fails without a reciever");
+
+	std::array<uint8_t, 4> injected = {4, 3, 2, 1};
+	air_2.inject(1, injected.begin(), injected.size());
+	check(radio_2.data_available(), "Injected payload available");
+	air_1.print_statistics();
+	air_2.print_statistics();
+
+	rf_test test(radio_1, radio_2);
+	check(test.test_static_configuration<rf24_config<>>(air_1, ce_1, csn_1), "rf24_static default configuration");
+	using node_config = rf24_config<rf24_250kbps, rf24_crc_8, 3, false, false, (1<<ERX_P1), 100, pwr_low>;
+	check(test.test_static_configuration<node_config>(air_1, ce_1, csn_1), "rf24_static fixed payload configuration");
+}
+
+void test_irq(void){
+	hwlib::cout << "\nTesting the IRQ pin of an emulated radio\n";
+	rf24_emulator air;
+	unused_pin ce, csn;
+	rf24 radio(air, ce, csn);
+	rf24_emulator_irq irq(air);
+	radio.begin();
+	radio.enter_rx_mode();
+	check(irq.get(), "IRQ high without data");
+	std::array<uint8_t, 4> data = {1, 2, 3, 4};
+	air.inject(1, data.begin(), data.size());
+	air.inject(2, data.begin(), data.size());
+	check(!irq.get(), "IRQ low after a payload has been recieved");
+	radio.read(data);
+	check(!irq.get(), "IRQ stays low while the RX FIFO has data");
+	radio.read(data);
+	check(irq.get(), "IRQ released after the last payload has been read");
+
+	rf24_async async_radio(radio);
+	async_radio.set_irq(irq);
+	async_operation recieved;
+	uint32_t value = 0;
+	async_radio.receive(recieved, value);
+	uint32_t transactions = air.get_transactions();
+	async_radio.poll();
+	async_radio.poll();
+	check(air.get_transactions() == transactions, "rf24_async skips the STATUS reads while IRQ is high");
+	air.inject(1, data.begin(), data.size());
+	async_radio.poll();
+	check(recieved.succeeded() && value == 0x04030201, "rf24_async recieves when IRQ goes low");
+	check(irq.get(), "IRQ released after the rf24_async read");
+}
+
+void test_multi_radio_irq(void){
+	hwlib::cout << "\nTesting multi_radio with the IRQ pin of an emulated reciever\n";
+	rf24_emulator air_1;
+	rf24_emulator air_2;
+	air_1.connect(air_2);
+	unused_pin ce_1, csn_1, ce_2, csn_2;
+	rf24 radio_1(air_1, ce_1, csn_1);
+	rf24 radio_2(air_2, ce_2, csn_2);
+	rf24_emulator_irq irq_2(air_2);
+	radio_1.begin();
+	radio_2.begin();
+	std::array<uint8_t, 5> address = {0x2F, 0xAC, 0xAC, 0xAC, 0xAC};
+	radio_1.set_transmit_address(address);
+	radio_2.set_recieve_address(1, address);
+
+	multi_radio<2> radios({&radio_1, &radio_2});
+	radios.set_role(1, role_rx);
+	radios.set_irq(1, irq_2);
+	radios.begin();
+	uint8_t recieved = 0;
+	for(uint8_t frame = 0; frame < 3; frame++){
+		radios.write(frame);
+		radios.flush();
+		size_t index;
+		uint8_t value = 0xFF;
+		while(radios.poll(index)){
+			radios.read(index, value);
+			recieved += (index == 1 && value == frame);
+		}
+		uint32_t transactions = air_2.get_transactions();
+		radios.poll(index);
+		check(air_2.get_transactions() == transactions, "No STATUS read of the reciever while IRQ is high");
+	}
+	check(recieved == 3, "All frames recieved");
+}
+
+void configure(rf24 & radio){
+	radio.begin();
+	radio.set_channel(90);
+	radio.set_data_rate(rf24_250kbps);
+	radio.set_transmit_address({0x3F, 0xAC, 0xAC, 0xAC, 0xAC});
+	radio.start_listening();
+	radio.data_available();
+}
+
+void test_trace_replay(void){
+	hwlib::cout << "\nTesting the replay of a recorded SPI trace\n";
+	rf24_emulator air;
+	spi_trace<128> trace(air);
+	unused_pin ce, csn;
+	rf24 recorded(trace, ce, csn);
+	configure(recorded);
+	check(trace.size() > 0 && trace.size() < 128, "Trace recorded");
+	trace.print_report();
+
+	spi_replay replay(trace);
+	rf24 replayed(replay, ce, csn);
+	configure(replayed);
+	check(replay.mismatches() == 0 && replay.finished(), "Replay matches the recorded transactions");
+
+	replay.rewind();
+	configure(replayed);
+	replayed.get_channel();
+	check(replay.mismatches() > 0, "Replay detects an extra transaction");
+}
+
+void test_radio(const char * device, const uint16_t & ce_gpio){
+	hwlib::cout << "\nTesting a radio on " << device << '\n';
+	spidev_bus bus(device);
+	check(bus.is_open(), "Open the spidev device");
+	sysfs_pin_out ce(ce_gpio);
+	unused_pin csn;
+	rf24 radio(bus, ce, csn);
+	std::array<uint8_t, 5> default_addr = {0xE7, 0xE7, 0xE7, 0xE7, 0xE7};
+	check(radio.read_register_5byte(R_REGISTER + RX_ADDR_P0) == default_addr, "Connection with the radio");
+	radio.begin();
+	radio.set_channel(76);
+	check(radio.get_channel() == 76, "set_channel");
+	radio.print_details();
+}
+
+int main(int argc, char ** argv){
+	if(argc == 3 && std::strcmp(argv[1], "-loopback") == 0){
+		spidev_bus bus(argv[2]);
+		check(bus.is_open(), "Open the spidev device");
+		test_loopback(bus);
+	}else if(argc == 4 && std::strcmp(argv[1], "-radio") == 0){
+		test_radio(argv[2], std::atoi(argv[3]));
+	}else if(argc == 1){
+		spi_loopback loopback;
+		test_loopback(loopback);
+		test_emulator();
+		test_irq();
+		test_multi_radio_irq();
+		test_trace_replay();
+	}else{
+		hwlib::cout << "Usage: hal_test [-loopback <spidev> | -radio <spidev> <ce gpio>]\n";
+		return 1;
+	}
+	hwlib::cout << (failed ? "\nSome checks failed\n" : "\nAll checks passed\n");
+	return failed ? 1 : 0;
+}
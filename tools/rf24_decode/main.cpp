@@ -0,0 +1,184 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+// Host tool that decodes a binary log written by rf24_log_writer.
+// Capture the serial console to a file and run:
+//   rf24_decode log.bin          human readable output
+//   rf24_decode -csv log.bin     CSV output, one row per record followed by the link and invalid rows:
+//                                link,channel,pipe,packets,bytes,min,max,interval_us
+//                                invalid,count
+// Use - as file name to read from stdin.
+
+#include "hwlib.hpp"
+#include "nrf24l01.hpp"
+#include "rf24_snapshot.hpp"
+#include "rf24_log.hpp"
+#include <cstdio>
+#include <cstring>
+
+/**
+ * \brief
+ * Statistics of the packets on one channel and pipe
+ */
+struct link_statistics{
+	uint8_t channel = 0;
+	uint8_t pipe = 0;
+	uint32_t packets = 0;
+	uint32_t bytes = 0;
+	uint8_t min_length = 32;
+	uint8_t max_length = 0;
+	uint32_t first_us = 0;
+	uint32_t last_us = 0;
+};
+
+const size_t max_links = 64;
+std::array<link_statistics, max_links> links;
+size_t link_count = 0;
+
+void print_hex(const uint8_t & byte){
+	const char digits[] = "0123456789abcdef";
+	hwlib::cout << digits[byte >> 4] << digits[byte & 0x0F];
+}
+
+void update_link(const uint8_t & channel, const uint8_t & pipe, const uint8_t & length, const uint32_t & timestamp){
+	size_t i = 0;
+	while(i < link_count && (links[i].channel != channel || links[i].pipe != pipe)){
+		i++;
+	}
+	if(i == link_count){
+		if(link_count == max_links){
+			return;
+		}
+		link_count++;
+		links[i].channel = channel;
+		links[i].pipe = pipe;
+		links[i].first_us = timestamp;
+	}
+	link_statistics & link = links[i];
+	link.packets++;
+	link.bytes += length;
+	link.min_length = std::min(link.min_length, length);
+	link.max_length = std::max(link.max_length, length);
+	link.last_us = timestamp;
+}
+
+void print_snapshot_record(const log_record & record, const bool & csv){
+	if(record.length != sizeof(rf24_snapshot)){
+		return;
+	}
+	rf24_snapshot snapshot;
+	std::memcpy(&snapshot, record.data, sizeof(snapshot));
+	std::array<const char *, 3> rate_str = {"rf24_1mbps", "rf24_2mbps", "rf24_250kbps"};
+	std::array<const char *, 4> pwr_str = {"pwr_min", "pwr_low", "pwr_high", "pwr_max"};
+	std::array<const char *, 3> crc_str = {"rf24_crc_disabled", "rf24_crc_8", "rf24_crc_16"};
+	if(csv){
+		hwlib::cout << "snapshot,,,,,";
+		print_hex(snapshot.status);
+		for(uint8_t i = 0; i < snapshot_registers; i++){
+			hwlib::cout << ' ';
+			print_hex(snapshot.registers[i]);
+		}
+		hwlib::cout << '\n';
+		return;
+	}
+	print_snapshot(hwlib::cout, snapshot);
+	hwlib::cout << "Channel: " << hwlib::dec << snapshot.registers[RF_CH]
+				<< "\nData rate: " << rate_str[snapshot_data_rate(snapshot)]
+				<< "\nPower level: " << pwr_str[snapshot_power_level(snapshot)]
+				<< "\nCRC length: " << crc_str[snapshot_crc_length(snapshot)] << "\n\n";
+}
+
+void print_packet_record(const log_record & record, const bool & csv){
+	if(record.length < log_packet_header || record.length < log_packet_header + record.data[6]){
+		return;
+	}
+	uint32_t timestamp = record.get32(0);
+	uint8_t channel = record.data[4];
+	uint8_t pipe = record.data[5];
+	uint8_t length = record.data[6];
+	update_link(channel, pipe, length, timestamp);
+	if(csv){
+		hwlib::cout << "packet," << hwlib::dec << timestamp << ',' << channel << ',' << pipe << ',' << length << ',';
+	}else{
+		hwlib::cout << hwlib::dec << timestamp << "us\tch=" << channel << " pipe=" << pipe << " len=" << length << "\t";
+	}
+	for(uint8_t i = 0; i < length; i++){
+		print_hex(record.data[log_packet_header + i]);
+	}
+	hwlib::cout << '\n';
+}
+
+void print_links(const bool & csv){
+	if(!csv){
+		hwlib::cout << "\nLink statistics\n";
+	}
+	for(size_t i = 0; i < link_count; i++){
+		const link_statistics & link = links[i];
+		uint32_t duration = link.last_us - link.first_us;
+		uint32_t interval = (link.packets > 1) ? duration / (link.packets - 1) : 0;
+		if(csv){
+			hwlib::cout << "link," << hwlib::dec << link.channel << ',' << link.pipe << ',' << link.packets << ','
+						<< link.bytes << ',' << link.min_length << ',' << link.max_length << ',' << interval << '\n';
+			continue;
+		}
+		hwlib::cout << "ch=" << hwlib::dec << link.channel << " pipe=" << link.pipe
+					<< "\tpackets=" << link.packets << " bytes=" << link.bytes
+					<< " length=" << link.min_length << "-" << link.max_length;
+		if(link.packets > 1 && duration){
+			hwlib::cout << " interval=" << interval << "us"
+						<< " rate=" << (uint32_t)(uint64_t(link.packets - 1) * 1000000 / duration) << " packets/s";
+		}
+		hwlib::cout << '\n';
+	}
+}
+
+int main(int argc, char ** argv){
+	bool csv = false;
+	const char * name = nullptr;
+	for(int i = 1; i < argc; i++){
+		if(std::strcmp(argv[i], "-csv") == 0){
+			csv = true;
+		}else{
+			name = argv[i];
+		}
+	}
+	if(name == nullptr){
+		hwlib::cout << "Usage: rf24_decode [-csv] <log file>\n";
+		return 1;
+	}
+	std::FILE * file = (std::strcmp(name, "-") == 0) ? stdin : std::fopen(name, "rb");
+	if(file == nullptr){
+		hwlib::cout << "Could not open " << name << '\n';
+		return 1;
+	}
+
+	if(csv){
+		hwlib::cout << "type,timestamp_us,channel,pipe,length,data\n";
+	}
+	rf24_log_parser parser;
+	int byte;
+	while((byte = std::fgetc(file)) != EOF){
+		if(!parser.feed(byte)){
+			continue;
+		}
+		const log_record & record = parser.record();
+		if(record.type == log_snapshot){
+			print_snapshot_record(record, csv);
+		}else if(record.type == log_packet){
+			print_packet_record(record, csv);
+		}
+	}
+	if(file != stdin){
+		std::fclose(file);
+	}
+
+	print_links(csv);
+	if(csv){
+		hwlib::cout << "invalid," << hwlib::dec << parser.invalid() << '\n';
+	}else{
+		hwlib::cout << "Invalid records: " << hwlib::dec << parser.invalid() << '\n';
+	}
+	return 0;
+}
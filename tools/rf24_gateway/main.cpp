@@ -0,0 +1,321 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+// Linux gateway that drains a radio and publishes the recieved frames on a Unix domain socket.
+//   rf24_gateway [options]
+//   -spi <device>     spidev device, /dev/spidev0.0 by default
+//   -ce <gpio>        GPIO of CE, 25 by default
+//   -emulate <rate>   use an emulated radio which recieves <rate> generated frames per second
+//   -socket <path>    socket path, /tmp/rf24.sock by default
+//   -ch <channel>     radio channel, 76 by default
+//   -rate 0|1|2       rf24_1mbps, rf24_2mbps or rf24_250kbps, rf24_2mbps by default
+//   -addr <hex>       5 byte address of pipe 1 as 10 hex digits LSB first, the address of
+//                     pipe 2-5 differs in the first byte only
+//   -text             send lines "timestamp_us channel pipe length hex" instead of log records
+//   -batch <us>       the longest time a frame waits to be sent to a client, 2000 by default
+//   -queue <kB>       the queue of each client, 1024 kB by default
+//   -priority <n>     run with real time priority n (SCHED_FIFO), so the gateway is not descheduled
+//                     for longer than the 3 frames the RX FIFO holds
+//
+// By default every frame is sent as a rf24_log packet record, decode the stream with
+//   socat UNIX-CONNECT:/tmp/rf24.sock - | rf24_decode -
+//
+// The radio is never kept waiting by a client: the frames are queued per client and written
+// in batches on a non-blocking socket. When the queue of a slow client is full its newest frames
+// are dropped and counted, the other clients and the radio are not affected.
+
+#include "hwlib.hpp"
+#include "rf24.hpp"
+#include "nrf24l01.hpp"
+#include "rf24_log.hpp"
+#include "rf24_emulator.hpp"
+#include "linux_hal.hpp"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sched.h>
+#include <csignal>
+#include <cerrno>
+#include <cstdlib>
+#include <vector>
+#include <memory>
+
+volatile std::sig_atomic_t running = 1;
+
+void stop(int){
+	running = 0;
+}
+
+/**
+ * \brief
+ * A connected client with its queue of encoded frames
+ */
+struct client{
+	int fd;
+	std::vector<uint8_t> queue;
+	size_t head = 0;
+	size_t size = 0;
+	uint64_t oldest_us = 0;
+	uint32_t frames = 0;
+	uint32_t dropped = 0;
+
+	client(const int & fd, const size_t & capacity):
+		fd(fd),
+		queue(capacity)
+	{}
+
+	/*
+	* Queue a frame as a whole, or drop it when it does not fit
+	*/
+	void push(const uint8_t * data, const size_t & length, const uint64_t & now){
+		if(size + length > queue.size()){
+			dropped++;
+			return;
+		}
+		if(size == 0){
+			oldest_us = now;
+		}
+		for(size_t i = 0; i < length; i++){
+			queue[(head + size + i) % queue.size()] = data[i];
+		}
+		size += length;
+		frames++;
+	}
+
+	/*
+	* Write as much of the queue as the socket takes, returns false when the client is gone
+	*/
+	bool flush(void){
+		while(size > 0){
+			size_t chunk = std::min(size, queue.size() - head);
+			ssize_t written = send(fd, queue.data() + head, chunk, MSG_DONTWAIT | MSG_NOSIGNAL);
+			if(written < 0){
+				return errno == EAGAIN || errno == EWOULDBLOCK;
+			}
+			head = (head + written) % queue.size();
+			size -= written;
+		}
+		return 1;
+	}
+};
+
+int open_socket(const char * path){
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if(fd < 0){
+		return -1;
+	}
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	std::strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+	unlink(path);
+	if(bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || listen(fd, 8) < 0){
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+size_t encode_text(char * out, const size_t & capacity, const uint32_t & timestamp, const uint8_t & channel,
+                   const uint8_t & pipe, const std::array<uint8_t, 32> & frame, const uint8_t & length){
+	const char digits[] = "0123456789abcdef";
+	int size = std::snprintf(out, capacity, "%u %u %u %u ", timestamp, channel, pipe, length);
+	for(uint8_t i = 0; i < length; i++){
+		out[size++] = digits[frame[i] >> 4];
+		out[size++] = digits[frame[i] & 0x0F];
+	}
+	out[size++] = '\n';
+	return size;
+}
+
+bool parse_address(const char * text, std::array<uint8_t, 5> & address){
+	if(std::strlen(text) != 10){
+		return 0;
+	}
+	for(uint8_t i = 0; i < 5; i++){
+		char byte[3] = {text[2 * i], text[2 * i + 1], 0};
+		char * end;
+		address[i] = std::strtoul(byte, &end, 16);
+		if(*end != 0){
+			return 0;
+		}
+	}
+	return 1;
+}
+
+int main(int argc, char ** argv){
+	const char * device = "/dev/spidev0.0";
+	const char * path = "/tmp/rf24.sock";
+	uint16_t ce_gpio = 25;
+	uint32_t emulate_rate = 0;
+	uint8_t channel = 76;
+	uint8_t rate = rf24_2mbps;
+	std::array<uint8_t, 5> address = {0xF0, 0xAB, 0xAB, 0xAB, 0xAB};
+	bool text = false;
+	uint32_t batch_us = 2000;
+	size_t queue_bytes = 1024 * 1024;
+	int priority = 0;
+	for(int i = 1; i < argc; i++){
+		bool has_value = i + 1 < argc;
+		if(std::strcmp(argv[i], "-spi") == 0 && has_value){
+			device = argv[++i];
+		}else if(std::strcmp(argv[i], "-ce") == 0 && has_value){
+			ce_gpio = std::atoi(argv[++i]);
+		}else if(std::strcmp(argv[i], "-emulate") == 0 && has_value){
+			emulate_rate = std::atoi(argv[++i]);
+		}else if(std::strcmp(argv[i], "-socket") == 0 && has_value){
+			path = argv[++i];
+		}else if(std::strcmp(argv[i], "-ch") == 0 && has_value){
+			channel = std::atoi(argv[++i]);
+		}else if(std::strcmp(argv[i], "-rate") == 0 && has_value){
+			rate = std::atoi(argv[++i]);
+		}else if(std::strcmp(argv[i], "-addr") == 0 && has_value && parse_address(argv[i + 1], address)){
+			i++;
+		}else if(std::strcmp(argv[i], "-text") == 0){
+			text = true;
+		}else if(std::strcmp(argv[i], "-batch") == 0 && has_value){
+			batch_us = std::atoi(argv[++i]);
+		}else if(std::strcmp(argv[i], "-queue") == 0 && has_value){
+			queue_bytes = size_t(std::atoi(argv[++i])) * 1024;
+		}else if(std::strcmp(argv[i], "-priority") == 0 && has_value){
+			priority = std::atoi(argv[++i]);
+		}else{
+			hwlib::cout << "Usage: rf24_gateway [-spi <device>] [-ce <gpio>] [-emulate <rate>] [-socket <path>] [-ch <channel>]\n"
+						<< "                    [-rate 0|1|2] [-addr <hex>] [-text] [-batch <us>] [-queue <kB>] [-priority <n>]\n";
+			return 1;
+		}
+	}
+
+	// The radio on spidev, or the emulator stand-in
+	unused_pin csn;
+	rf24_emulator air;
+	std::unique_ptr<spidev_bus> spi_bus;
+	std::unique_ptr<sysfs_pin_out> ce_pin;
+	unused_pin ce_unused;
+	hwlib::spi_bus * bus = &air;
+	hwlib::pin_out * ce = &ce_unused;
+	if(emulate_rate == 0){
+		spi_bus.reset(new spidev_bus(device));
+		ce_pin.reset(new sysfs_pin_out(ce_gpio));
+		if(!spi_bus->is_open()){
+			return 1;
+		}
+		bus = spi_bus.get();
+		ce = ce_pin.get();
+	}
+	rf24 radio(*bus, *ce, csn);
+	radio.begin();
+	radio.set_channel(channel);
+	radio.set_data_rate(rate);
+	radio.set_recieve_address(1, address);
+	for(uint8_t pipe = 2; pipe < 6; pipe++){
+		std::array<uint8_t, 5> pipe_address = address;
+		pipe_address[0] += pipe - 1;
+		radio.set_recieve_address(pipe, pipe_address);
+		radio.enable_pipe(pipe);
+	}
+	radio.enter_rx_mode();
+
+	int server = open_socket(path);
+	if(server < 0){
+		hwlib::cout << "Could not open the socket " << path << '\n';
+		return 1;
+	}
+	if(priority > 0){
+		sched_param param = {};
+		param.sched_priority = priority;
+		if(sched_setscheduler(0, SCHED_FIFO, &param) < 0){
+			hwlib::cout << "Could not set the real time priority\n";
+		}
+	}
+	std::signal(SIGINT, stop);
+	std::signal(SIGTERM, stop);
+	hwlib::cout << "Gateway on channel " << hwlib::dec << channel << ", publishing on " << path << '\n';
+
+	std::vector<std::unique_ptr<client>> clients;
+	std::array<uint8_t, 32> frame;
+	std::array<uint8_t, 128> encoded;
+	uint32_t frames = 0;
+	uint32_t unclaimed = 0;
+	uint32_t emulated = 0;
+	uint64_t start = hwlib::now_us();
+	uint64_t last_frame_us = 0;
+	while(running){
+		uint64_t now = hwlib::now_us();
+		if(emulate_rate){
+			// Generate the frames that are due, sequence number first. Like on a real radio a frame
+			// that finds the RX FIFO full is lost, the emulator counts those as overflows.
+			while(uint64_t(emulated) * 1000000 < (now - start) * emulate_rate){
+				std::array<uint8_t, 12> generated = {0};
+				for(uint8_t i = 0; i < 4; i++){
+					generated[i] = uint8_t(emulated >> (8 * i));
+				}
+				air.inject(1 + emulated % 5, generated.begin(), generated.size());
+				emulated++;
+			}
+		}
+
+		// Drain the radio first, the clients only get the time that is left
+		bool idle = true;
+		uint8_t pipe = 0;
+		uint8_t length;
+		while((length = radio.read_frame(frame, pipe)) > 0){
+			idle = false;
+			frames++;
+			uint32_t timestamp = hwlib::now_us();
+			size_t size = text ? encode_text(reinterpret_cast<char *>(encoded.begin()), encoded.size(), timestamp, channel, pipe, frame, length)
+			                   : log_encode_packet(encoded.begin(), timestamp, channel, pipe, frame.begin(), length);
+			if(clients.empty()){
+				unclaimed++;
+			}
+			for(auto & c : clients){
+				c->push(encoded.begin(), size, now);
+			}
+		}
+
+		int fd = accept4(server, nullptr, nullptr, SOCK_NONBLOCK);
+		if(fd >= 0){
+			clients.emplace_back(new client(fd, queue_bytes));
+			hwlib::cout << "Client connected, " << hwlib::dec << clients.size() << " clients\n";
+		}
+
+		// Write in batches: a full chunk or a frame that waited long enough
+		for(size_t i = 0; i < clients.size(); i++){
+			client & c = *clients[i];
+			if(c.size == 0 || (c.size < 4096 && now - c.oldest_us < batch_us)){
+				continue;
+			}
+			if(!c.flush()){
+				hwlib::cout << "Client disconnected, frames=" << hwlib::dec << c.frames << " dropped=" << c.dropped << '\n';
+				close(c.fd);
+				clients.erase(clients.begin() + i);
+				i--;
+				continue;
+			}
+			c.oldest_us = now;
+		}
+
+		if(!idle){
+			last_frame_us = now;
+		}else if(now - last_frame_us > 2000){
+			// Poll without sleeping while frames arrive, a sleep on Linux easily takes longer than
+			// the 3 frames the RX FIFO holds. Sleep when the channel has been quiet for a while.
+			hwlib::wait_us(100);
+		}
+	}
+
+	for(auto & c : clients){
+		c->flush();
+		close(c->fd);
+	}
+	close(server);
+	unlink(path);
+	uint64_t duration = hwlib::now_us() - start;
+	hwlib::cout << "\nFrames=" << hwlib::dec << frames << " unclaimed=" << unclaimed
+				<< " rate=" << (uint32_t)(duration ? uint64_t(frames) * 1000000 / duration : 0) << " frames/s\n";
+	if(emulate_rate){
+		air.print_statistics();
+		hwlib::cout << "Generated=" << emulated << '\n';
+	}
+	return 0;
+}
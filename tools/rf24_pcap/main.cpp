@@ -0,0 +1,183 @@
+//          Copyright Nathan Hoekstra 2018.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+// Host tool that converts the frames captured by rf24_capture to a pcap file.
+//   rf24_pcap [-aw 3|4|5] [-crc 1|2] [-all] <log file> <pcap file>
+// -aw is the address width and -crc the CRC length used by the captured radios (5 and 2 by default).
+// Only packets with a correct CRC are written, unless -all is given.
+//
+// The raw frame is split into the Enhanced ShockBurst fields: address, the 9 bit packet control field
+// (6 bit length, 2 bit PID, no acknowledge flag), payload and CRC. A captured frame is 32 bytes, so with
+// a 5 byte address and a 2 byte CRC payloads up to 23 bytes can be checked.
+//
+// The pcap uses link type USER0 (147), every packet is:
+//   channel, address width, address, length, PID, no acknowledge flag, payload, CRC, CRC correct flag
+
+#include "hwlib.hpp"
+#include "nrf24l01.hpp"
+#include "rf24_log.hpp"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+const uint32_t linktype_user0 = 147;
+
+bool get_bit(const uint8_t * frame, const uint16_t & bit){
+	return frame[bit / 8] & (0x80 >> (bit % 8));
+}
+
+uint8_t get_byte(const uint8_t * frame, const uint16_t & bit){
+	uint8_t value = 0;
+	for(uint8_t i = 0; i < 8; i++){
+		value = (value << 1) | get_bit(frame, bit + i);
+	}
+	return value;
+}
+
+uint16_t packet_crc(const uint8_t * frame, const uint16_t & bits, const uint8_t & crc_length){
+	if(crc_length == 1){
+		uint8_t crc = 0xFF;
+		for(uint16_t i = 0; i < bits; i++){
+			bool feedback = ((crc >> 7) & 1) ^ get_bit(frame, i);
+			crc = (crc << 1) ^ (feedback ? 0x07 : 0x00);
+		}
+		return crc;
+	}
+	uint16_t crc = 0xFFFF;
+	for(uint16_t i = 0; i < bits; i++){
+		bool feedback = ((crc >> 15) & 1) ^ get_bit(frame, i);
+		crc = (crc << 1) ^ (feedback ? 0x1021 : 0x0000);
+	}
+	return crc;
+}
+
+void put32(std::FILE * file, const uint32_t & value){
+	for(uint8_t i = 0; i < 4; i++){
+		std::fputc(uint8_t(value >> (8 * i)), file);
+	}
+}
+
+void put16(std::FILE * file, const uint16_t & value){
+	std::fputc(uint8_t(value), file);
+	std::fputc(uint8_t(value >> 8), file);
+}
+
+int main(int argc, char ** argv){
+	uint8_t address_width = 5;
+	uint8_t crc_length = 2;
+	bool all = false;
+	const char * names[2] = {nullptr, nullptr};
+	uint8_t name_count = 0;
+	for(int i = 1; i < argc; i++){
+		if(std::strcmp(argv[i], "-aw") == 0 && i + 1 < argc){
+			address_width = std::atoi(argv[++i]);
+		}else if(std::strcmp(argv[i], "-crc") == 0 && i + 1 < argc){
+			crc_length = std::atoi(argv[++i]);
+		}else if(std::strcmp(argv[i], "-all") == 0){
+			all = true;
+		}else if(name_count < 2){
+			names[name_count++] = argv[i];
+		}
+	}
+	if(name_count != 2 || address_width < 3 || address_width > 5 || crc_length < 1 || crc_length > 2){
+		hwlib::cout << "Usage: rf24_pcap [-aw 3|4|5] [-crc 1|2] [-all] <log file> <pcap file>\n";
+		return 1;
+	}
+	std::FILE * in = (std::strcmp(names[0], "-") == 0) ? stdin : std::fopen(names[0], "rb");
+	std::FILE * out = std::fopen(names[1], "wb");
+	if(in == nullptr || out == nullptr){
+		hwlib::cout << "Could not open the files\n";
+		return 1;
+	}
+
+	// pcap global header
+	put32(out, 0xa1b2c3d4);
+	put16(out, 2);
+	put16(out, 4);
+	put32(out, 0);
+	put32(out, 0);
+	put32(out, 64);
+	put32(out, linktype_user0);
+
+	rf24_log_parser parser;
+	uint32_t frames = 0;
+	uint32_t valid = 0;
+	uint32_t written = 0;
+	uint64_t time_us = 0;
+	uint32_t previous_us = 0;
+	int byte;
+	while((byte = std::fgetc(in)) != EOF){
+		if(!parser.feed(byte)){
+			continue;
+		}
+		const log_record & record = parser.record();
+		if(record.type != log_capture || record.length != log_capture_header + 32){
+			continue;
+		}
+		frames++;
+		// The 32 bit timestamp of the board wraps around, keep counting in 64 bits
+		uint32_t timestamp = record.get32(0);
+		time_us += (frames == 1) ? timestamp : uint32_t(timestamp - previous_us);
+		previous_us = timestamp;
+		uint8_t channel = record.data[4];
+		const uint8_t * frame = record.data + log_capture_header;
+
+		uint16_t bit = address_width * 8;
+		uint8_t length = 0;
+		for(uint8_t i = 0; i < 6; i++){
+			length = (length << 1) | get_bit(frame, bit++);
+		}
+		uint8_t pid = (get_bit(frame, bit) << 1) | get_bit(frame, bit + 1);
+		bit += 2;
+		bool no_ack = get_bit(frame, bit++);
+		uint16_t crc_bit = bit + length * 8;
+		if(length > 32 || crc_bit + crc_length * 8 > 256){
+			continue;
+		}
+		uint16_t crc = 0;
+		for(uint8_t i = 0; i < crc_length; i++){
+			crc = (crc << 8) | get_byte(frame, crc_bit + i * 8);
+		}
+		bool crc_ok = crc == packet_crc(frame, crc_bit, crc_length);
+		if(crc_ok){
+			valid++;
+		}
+		if(!crc_ok && !all){
+			continue;
+		}
+
+		std::array<uint8_t, 64> packet;
+		uint8_t size = 0;
+		packet[size++] = channel;
+		packet[size++] = address_width;
+		for(uint8_t i = 0; i < address_width; i++){
+			packet[size++] = frame[i];
+		}
+		packet[size++] = length;
+		packet[size++] = pid;
+		packet[size++] = no_ack;
+		for(uint8_t i = 0; i < length; i++){
+			packet[size++] = get_byte(frame, bit + i * 8);
+		}
+		for(uint8_t i = 0; i < crc_length; i++){
+			packet[size++] = get_byte(frame, crc_bit + i * 8);
+		}
+		packet[size++] = crc_ok;
+
+		put32(out, time_us / 1000000);
+		put32(out, time_us % 1000000);
+		put32(out, size);
+		put32(out, size);
+		std::fwrite(packet.begin(), 1, size, out);
+		written++;
+	}
+	if(in != stdin){
+		std::fclose(in);
+	}
+	std::fclose(out);
+	hwlib::cout << "Frames: " << hwlib::dec << frames << " CRC correct: " << valid << " written: " << written
+				<< " invalid records: " << parser.invalid() << '\n';
+	return 0;
+}